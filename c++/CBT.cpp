@@ -1,217 +1,196 @@
-#include <benchmark/benchmark.h>
 #include <gtest/gtest.h>
 #include <iostream>
 #include <sstream>
 #include <fstream>
 #include <queue>
+#include <vector>
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <cstddef>
+#include <atomic>
+#include <filesystem>
+#include "CBT.h"
 
+TEST(CompleteBinaryTreeTest, InsertAndBreadthFirstTraversal) {
+    CompleteBinaryTree<int> myTree;
 
-template <typename T>
-struct TreeNode {
-    T data;
-    TreeNode* left;
-    TreeNode* right;
-
-    TreeNode(const T& value) : data(value), left(nullptr), right(nullptr) {}
-};
-
-template <typename T>
-class CompleteBinaryTree {
-private:
-    TreeNode<T>* root;
-
-public:
-    CompleteBinaryTree() : root(nullptr) {}
-
-    void insert(const T& value) {
-        TreeNode<T>* newNode = new TreeNode<T>(value);
-
-        if (!root) {
-            root = newNode;
-            return;
-        }
-
-        std::queue<TreeNode<T>*> nodesQueue;
-        nodesQueue.push(root);
-
-        while (!nodesQueue.empty()) {
-            TreeNode<T>* current = nodesQueue.front();
-            nodesQueue.pop();
-
-            if (!current->left) {
-                current->left = newNode;
-                return;
-            }
-            else {
-                nodesQueue.push(current->left);
-            }
-
-            if (!current->right) {
-                current->right = newNode;
-                return;
-            }
-            else {
-                nodesQueue.push(current->right);
-            }
-        }
-    }
+    myTree.insert(1);
+    myTree.insert(2);
+    myTree.insert(3);
+    myTree.insert(4);
+    myTree.insert(5);
 
-    void breadthFirstTraversal() const {
-        if (!root) {
-            std::cout << "The tree is empty." << std::endl;
-            return;
-        }
+    testing::internal::CaptureStdout();
+    myTree.breadthFirstTraversal();
+    std::string output = testing::internal::GetCapturedStdout();
 
-        std::queue<TreeNode<T>*> nodesQueue;
-        nodesQueue.push(root);
+    EXPECT_EQ(output, "1 2 3 4 5 \n");
+}
 
-        while (!nodesQueue.empty()) {
-            TreeNode<T>* current = nodesQueue.front();
-            nodesQueue.pop();
+TEST(CompleteBinaryTreeTest, EmptyTreeTraversal) {
+    CompleteBinaryTree<int> emptyTree;
 
-            std::cout << current->data << " ";
+    testing::internal::CaptureStdout();
+    emptyTree.breadthFirstTraversal();
+    std::string output = testing::internal::GetCapturedStdout();
 
-            if (current->left) {
-                nodesQueue.push(current->left);
-            }
+    EXPECT_EQ(output, "The tree is empty.\n");
+}
 
-            if (current->right) {
-                nodesQueue.push(current->right);
-            }
-        }
+TEST(CompleteBinaryTreeTest, TraversalOrders) {
+    CompleteBinaryTree<int> myTree;
 
-        std::cout << std::endl;
+    for (int value = 1; value <= 10; ++value) {
+        myTree.insert(value);
     }
 
-    std::string serializeText() const {
-        std::ostringstream oss;
+    std::vector<int> levelOrder(myTree.begin(), myTree.end());
+    std::vector<int> preOrder(myTree.preOrder().begin(), myTree.preOrder().end());
+    std::vector<int> inOrder;
+    myTree.visit([&](int value) { inOrder.push_back(value); }, TraversalOrder::InOrder);
 
-        serializeTextHelper(root, oss);
-
-        return oss.str();
-    }
-
-    void serializeTextHelper(TreeNode<T>* node, std::ostringstream& oss) const {
-        if (!node) {
-            oss << "null ";
-            return;
-        }
+    EXPECT_EQ(levelOrder, std::vector<int>({ 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 }));
+    EXPECT_EQ(preOrder, std::vector<int>({ 1, 2, 4, 8, 9, 5, 10, 3, 6, 7 }));
+    EXPECT_EQ(inOrder, std::vector<int>({ 8, 4, 9, 2, 10, 5, 1, 6, 3, 7 }));
+    EXPECT_EQ(std::count_if(myTree.begin(), myTree.end(), [](int value) { return value % 2 == 0; }), 5);
+}
 
-        oss << node->data << " ";
-        serializeTextHelper(node->left, oss);
-        serializeTextHelper(node->right, oss);
-    }
+TEST(CompleteBinaryTreeTest, SerializeAndDeserializeBinary) {
+    CompleteBinaryTree<int> myTree;
 
-    void deserializeText(const std::string& data) {
-        std::istringstream iss(data);
-        root = deserializeTextHelper(iss);
+    for (int value = 1; value <= 6; ++value) {
+        myTree.insert(value);
     }
 
-    TreeNode<T>* deserializeTextHelper(std::istringstream& iss) {
-        std::string token;
-        iss >> token;
+    myTree.serializeBinary("binary_tree_data.bin");
 
-        if (token == "null") {
-            return nullptr;
-        }
+    CompleteBinaryTree<int> newTree;
+    newTree.deserializeBinary("binary_tree_data.bin");
 
-        T value;
-        std::istringstream(token) >> value;
+    EXPECT_EQ(newTree.size(), 6u);
+    EXPECT_EQ(std::vector<int>(newTree.begin(), newTree.end()), std::vector<int>({ 1, 2, 3, 4, 5, 6 }));
 
-        TreeNode<T>* node = new TreeNode<T>(value);
-        node->left = deserializeTextHelper(iss);
-        node->right = deserializeTextHelper(iss);
+    ASSERT_TRUE(myTree.serializeBinaryAsync("binary_tree_data.bin").get());
+    CompleteBinaryTree<int> asyncTree;
+    asyncTree.deserializeBinary("binary_tree_data.bin");
 
-        return node;
-    }
+    EXPECT_EQ(std::vector<int>(asyncTree.begin(), asyncTree.end()), std::vector<int>({ 1, 2, 3, 4, 5, 6 }));
+}
 
-    void serializeBinary(const std::string& filename) const {
-        std::ofstream ofs(filename, std::ios::binary);
+TEST(CompleteBinaryTreeTest, RejectIncompleteInput) {
+    CompleteBinaryTree<int> myTree;
 
-        if (ofs.is_open()) {
-            serializeBinaryHelper(root, ofs);
-            ofs.close();
-        }
-        else {
-            std::cerr << "Unable to open the file for binary serialization." << std::endl;
-        }
+    for (int value = 1; value <= 10; ++value) {
+        myTree.insert(value);
     }
 
-    void serializeBinaryHelper(TreeNode<T>* node, std::ofstream& ofs) const {
-        if (!node) {
-            return;
-        }
+    myTree.serializeBinary("binary_tree_data.bin");
+    std::filesystem::resize_file("binary_tree_data.bin", std::filesystem::file_size("binary_tree_data.bin") - 3 * sizeof(int));
 
-        ofs.write(reinterpret_cast<char*>(&node->data), sizeof(T));
-        serializeBinaryHelper(node->left, ofs);
-        serializeBinaryHelper(node->right, ofs);
-    }
+    CompleteBinaryTree<int> newTree;
+    newTree.insert(42);
+    newTree.deserializeBinary("binary_tree_data.bin");
 
-    void deserializeBinary(const std::string& filename) {
-        std::ifstream ifs(filename, std::ios::binary);
+    EXPECT_EQ(newTree.size(), 1u);
+    EXPECT_EQ(std::vector<int>(newTree.begin(), newTree.end()), std::vector<int>({ 42 }));
 
-        if (ifs.is_open()) {
-            root = deserializeBinaryHelper(ifs);
-            ifs.close();
-        }
-        else {
-            std::cerr << "Unable to open the file for binary deserialization." << std::endl;
-        }
-    }
+    // A root with only a right child, and a tree whose last level has a gap.
+    newTree.deserializeText("1 null 2 null null ");
+    newTree.deserializeText("1 2 null null 3 4 null null null ");
+    EXPECT_EQ(std::vector<int>(newTree.begin(), newTree.end()), std::vector<int>({ 42 }));
 
-    TreeNode<T>* deserializeBinaryHelper(std::ifstream& ifs) {
-        T value;
-        ifs.read(reinterpret_cast<char*>(&value), sizeof(T));
+    newTree.deserializeText(myTree.serializeText());
+    EXPECT_EQ(newTree.size(), 10u);
+    EXPECT_EQ(std::vector<int>(newTree.begin(), newTree.end()), std::vector<int>({ 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 }));
+}
 
-        if (!ifs) {
-            return nullptr;
-        }
+TEST(CompleteBinaryTreeTest, ParallelVisit) {
+    CompleteBinaryTree<int> myTree;
+    ThreadPool pool(4);
+    std::atomic<long long> sum(0);
+    std::atomic<int> visited(0);
 
-        TreeNode<T>* node = new TreeNode<T>(value);
-        node->left = deserializeBinaryHelper(ifs);
-        node->right = deserializeBinaryHelper(ifs);
+    myTree.parallelVisit([&](int value) { sum += value; }, pool);
+    EXPECT_EQ(sum.load(), 0);
 
-        return node;
+    for (int value = 1; value <= 1000; ++value) {
+        myTree.insert(value);
     }
 
-};
+    myTree.parallelVisit([&](int value) { sum += value; ++visited; }, pool);
+    EXPECT_EQ(sum.load(), 500500);
+    EXPECT_EQ(visited.load(), 1000);
+}
 
-TEST(CompleteBinaryTreeTest, InsertAndBreadthFirstTraversal) {
-    CompleteBinaryTree<int> myTree;
+TEST(CompleteBinaryTreeTest, BuildFromAndLoad) {
+    CompleteBinaryTree<int> insertedTree;
+    std::vector<int> values;
+    ThreadPool pool(4);
 
-    myTree.insert(1);
-    myTree.insert(2);
-    myTree.insert(3);
-    myTree.insert(4);
-    myTree.insert(5);
+    for (int value = 1; value <= 1000; ++value) {
+        insertedTree.insert(value);
+        values.push_back(value);
+    }
 
-    testing::internal::CaptureStdout();
-    myTree.breadthFirstTraversal();
-    std::string output = testing::internal::GetCapturedStdout();
+    CompleteBinaryTree<int> builtTree;
+    builtTree.buildFrom(values.begin(), values.end(), pool);
+
+    std::vector<int> insertedPreOrder(insertedTree.preOrder().begin(), insertedTree.preOrder().end());
+    std::vector<int> insertedInOrder(insertedTree.inOrder().begin(), insertedTree.inOrder().end());
+
+    EXPECT_EQ(builtTree.size(), 1000u);
+    EXPECT_EQ(std::vector<int>(builtTree.begin(), builtTree.end()), values);
+    EXPECT_EQ(std::vector<int>(builtTree.preOrder().begin(), builtTree.preOrder().end()), insertedPreOrder);
+    EXPECT_EQ(std::vector<int>(builtTree.inOrder().begin(), builtTree.inOrder().end()), insertedInOrder);
+
+    builtTree.insert(1001);
+    EXPECT_EQ(builtTree.size(), 1001u);
+    EXPECT_EQ(*std::prev(std::vector<int>(builtTree.begin(), builtTree.end()).end()), 1001);
+
+    insertedTree.serializeBinary("binary_tree_data.bin");
+    CompleteBinaryTree<int> loadedTree;
+    loadedTree.load("binary_tree_data.bin", pool);
+
+    EXPECT_EQ(std::vector<int>(loadedTree.begin(), loadedTree.end()), values);
+    EXPECT_EQ(std::vector<int>(loadedTree.preOrder().begin(), loadedTree.preOrder().end()), insertedPreOrder);
+
+    loadedTree.load("missing_tree_data.bin", pool);
+    EXPECT_EQ(loadedTree.size(), 1000u);
+
+    std::vector<std::string> words = { "a", "b", "c", "d", "e", "a string too long to be short" };
+    CompleteBinaryTree<std::string> wordTree(words.begin(), words.end());
+    wordTree.serializeBinary("binary_tree_data.bin");
+
+    CompleteBinaryTree<std::string> loadedWords;
+    loadedWords.load("binary_tree_data.bin", pool);
+    EXPECT_EQ(std::vector<std::string>(loadedWords.begin(), loadedWords.end()), words);
+
+    // Deserializing over a bulk-built tree frees its block and every node.
+    using StringTree = CompleteBinaryTree<std::string>;
+    CounterSnapshot before = StringTree::counters();
+    {
+        StringTree replaced(words.begin(), words.end());
+        replaced.deserializeText("x y null null z null null ");
+        EXPECT_EQ(replaced.size(), 3u);
+        replaced.buildFrom(words.begin(), words.end(), pool);
+        replaced.deserializeBinary("binary_tree_data.bin");
+        EXPECT_EQ(std::vector<std::string>(replaced.begin(), replaced.end()), words);
+    }
+    EXPECT_EQ((StringTree::counters() - before)[Counter::LiveNodes], 0);
 
-    EXPECT_EQ(output, "1 2 3 4 5 \n");
+    builtTree.buildFrom(values.begin(), values.begin(), pool);
+    EXPECT_EQ(builtTree.size(), 0u);
+    EXPECT_TRUE(builtTree.begin() == builtTree.end());
 }
 
-TEST(CompleteBinaryTreeTest, EmptyTreeTraversal) {
+TEST(CompleteBinaryTreeTest, EmptyTreeIterators) {
     CompleteBinaryTree<int> emptyTree;
 
-    testing::internal::CaptureStdout();
-    emptyTree.breadthFirstTraversal();
-    std::string output = testing::internal::GetCapturedStdout();
-
-    EXPECT_EQ(output, "The tree is empty.\n");
-}
-
-static void BM_Insert(benchmark::State& state) {
-    CompleteBinaryTree<int> myTree;
-
-    for (auto _ : state) {
-        myTree.insert(42);
-    }
+    EXPECT_TRUE(emptyTree.begin() == emptyTree.end());
+    EXPECT_TRUE(emptyTree.preOrder().begin() == emptyTree.preOrder().end());
+    EXPECT_TRUE(emptyTree.inOrder().begin() == emptyTree.inOrder().end());
 }
-BENCHMARK(BM_Insert);
-
-BENCHMARK_MAIN();
 
 int main(int argc, char** argv) {
     CompleteBinaryTree<int> myTree;
@@ -0,0 +1,769 @@
+#pragma once
+
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <queue>
+#include <vector>
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <cstddef>
+#include <atomic>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include "binaryIO.h"
+#include "asyncWriter.h"
+#include "textIO.h"
+#include "mappedView.h"
+#include "workStealing.h"
+#include "instrumentation.h"
+
+template <typename T>
+struct TreeNode {
+    T data;
+    TreeNode* left;
+    TreeNode* right;
+
+    TreeNode(const T& value) : data(value), left(nullptr), right(nullptr) {}
+};
+
+enum class TraversalOrder {
+    LevelOrder,
+    PreOrder,
+    InOrder
+};
+
+template <typename T>
+class CompleteBinaryTree {
+private:
+    TreeNode<T>* root;
+    size_t count;
+
+    // Nodes made by buildFrom and load share one allocation, laid out in
+    // pre-order so that every subtree is a contiguous run of it. Nodes added
+    // later by insert are allocated on their own.
+    TreeNode<T>* block;
+    size_t blockSize;
+
+    bool inBlock(const TreeNode<T>* node) const {
+        std::less<const TreeNode<T>*> before;
+        return !before(node, block) && before(node, block + blockSize);
+    }
+
+    void destroyNodes() {
+        releaseSubtree(root);
+        ::operator delete(block);
+        root = nullptr;
+        count = 0;
+        block = nullptr;
+        blockSize = 0;
+    }
+
+    void releaseSubtree(TreeNode<T>* node) {
+        std::vector<TreeNode<T>*> pending;
+
+        if (node) {
+            pending.push_back(node);
+        }
+
+        while (!pending.empty()) {
+            TreeNode<T>* node = pending.back();
+            pending.pop_back();
+
+            if (node->left) {
+                pending.push_back(node->left);
+            }
+
+            if (node->right) {
+                pending.push_back(node->right);
+            }
+
+            if (inBlock(node)) {
+                node->~TreeNode();
+            }
+            else {
+                delete node;
+            }
+
+            Counters::released(sizeof(TreeNode<T>));
+        }
+    }
+
+    // True when the tree under node is the complete tree of `size` nodes, the
+    // shape the iterators and visit navigate by index arithmetic: every node
+    // has a level-order index below size, so the indices are exactly 0..size-1.
+    static bool isComplete(TreeNode<T>* node, size_t size) {
+        std::vector<std::pair<TreeNode<T>*, size_t>> pending;
+        size_t nodes = 0;
+
+        if (node) {
+            pending.emplace_back(node, 0);
+        }
+
+        while (!pending.empty()) {
+            auto [current, index] = pending.back();
+            pending.pop_back();
+
+            if (index >= size) {
+                return false;
+            }
+
+            ++nodes;
+
+            if (current->left) {
+                pending.emplace_back(current->left, 2 * index + 1);
+            }
+
+            if (current->right) {
+                pending.emplace_back(current->right, 2 * index + 2);
+            }
+        }
+
+        return nodes == size;
+    }
+
+    // Number of nodes under level-order index in a complete tree of `size`
+    // nodes: on every level below it the subtree covers a run of indices twice
+    // as wide as on the level before, cut off at the end of the tree.
+    static size_t subtreeSize(size_t index, size_t size) {
+        size_t nodes = 0;
+
+        for (size_t first = index, width = 1; first < size; first = 2 * first + 1, width *= 2) {
+            nodes += std::min(width, size - first);
+        }
+
+        return nodes;
+    }
+
+    // Constructs the node at level-order index in pre-order slot `slot` of the
+    // block, followed by its subtree, and returns the subtree's size.
+    // source(index, slot) gives the value of a node.
+    template <typename Source>
+    size_t buildSubtree(size_t index, size_t slot, const Source& source) {
+        TreeNode<T>* node = new (block + slot) TreeNode<T>(source(index, slot));
+        size_t nodes = 1;
+
+        if (2 * index + 1 < count) {
+            node->left = block + slot + 1;
+            nodes += buildSubtree(2 * index + 1, slot + 1, source);
+        }
+
+        if (2 * index + 2 < count) {
+            node->right = block + slot + nodes;
+            nodes += buildSubtree(2 * index + 2, slot + nodes, source);
+        }
+
+        return nodes;
+    }
+
+    // The same near the root, where right subtrees become tasks on the pool;
+    // their slots follow from the shape alone, so no task waits for another.
+    template <typename Source>
+    void buildSpawning(size_t index, size_t slot, size_t spawnDepth, ThreadPool::TaskGroup& group, const Source& source) {
+        if (spawnDepth == 0) {
+            buildSubtree(index, slot, source);
+            return;
+        }
+
+        TreeNode<T>* node = new (block + slot) TreeNode<T>(source(index, slot));
+        size_t left = 2 * index + 1;
+        size_t right = 2 * index + 2;
+
+        if (right < count) {
+            size_t rightSlot = slot + 1 + subtreeSize(left, count);
+            node->right = block + rightSlot;
+            group.run([this, right, rightSlot, spawnDepth, &group, &source]() {
+                buildSpawning(right, rightSlot, spawnDepth - 1, group, source);
+            });
+        }
+
+        if (left < count) {
+            node->left = block + slot + 1;
+            buildSpawning(left, slot + 1, spawnDepth - 1, group, source);
+        }
+    }
+
+    // Replaces the tree with one of `size` nodes in a single block.
+    template <typename Source>
+    void build(size_t size, const Source& source, ThreadPool& pool) {
+        destroyNodes();
+
+        if (size == 0) {
+            return;
+        }
+
+        block = static_cast<TreeNode<T>*>(::operator new(size * sizeof(TreeNode<T>)));
+        blockSize = size;
+        count = size;
+        Counters::allocated(size * sizeof(TreeNode<T>), size);
+        Counters::operation(size);
+
+        size_t spawnDepth = 0;
+
+        while ((size_t(1) << spawnDepth) < pool.size() * 8) {
+            ++spawnDepth;
+        }
+
+        ThreadPool::TaskGroup group(pool);
+        buildSpawning(0, 0, spawnDepth, group, source);
+        group.wait();
+        root = block;
+    }
+
+    template <typename Group, typename Visitor>
+    static void visitSubtree(TreeNode<T>* node, size_t spawnDepth, Group& group, const Visitor& visitor) {
+        if (!node) {
+            return;
+        }
+
+        visitor(node->data);
+
+        if (spawnDepth > 0 && node->right) {
+            TreeNode<T>* right = node->right;
+            group.run([right, spawnDepth, &group, &visitor]() { visitSubtree(right, spawnDepth - 1, group, visitor); });
+            visitSubtree(node->left, spawnDepth - 1, group, visitor);
+        }
+        else {
+            visitSubtree(node->left, 0, group, visitor);
+            visitSubtree(node->right, 0, group, visitor);
+        }
+    }
+
+public:
+    // Walks the tree without a queue or recursion. Because the tree is complete,
+    // the node at level-order index i has children 2i+1 and 2i+2, so only the
+    // path from the root to the current node has to be kept.
+    template <TraversalOrder Order>
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        Iterator() : size(0), visited(0), index(0), depth(0), path{} {}
+
+        Iterator(TreeNode<T>* root, size_t size, size_t visited)
+            : size(size), visited(visited), index(0), depth(0), path{} {
+            if (visited >= size) {
+                this->visited = size;
+                return;
+            }
+
+            path[0] = root;
+
+            if (Order == TraversalOrder::InOrder) {
+                descendLeft();
+            }
+        }
+
+        reference operator*() const {
+            return path[depth]->data;
+        }
+
+        pointer operator->() const {
+            return &path[depth]->data;
+        }
+
+        Iterator& operator++() {
+            if (++visited >= size) {
+                visited = size;
+                return *this;
+            }
+
+            if (Order == TraversalOrder::LevelOrder) {
+                advanceLevelOrder();
+            }
+            else if (Order == TraversalOrder::PreOrder) {
+                advancePreOrder();
+            }
+            else {
+                advanceInOrder();
+            }
+
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            Iterator previous = *this;
+            ++(*this);
+            return previous;
+        }
+
+        bool operator==(const Iterator& other) const {
+            return visited == other.visited;
+        }
+
+        bool operator!=(const Iterator& other) const {
+            return visited != other.visited;
+        }
+
+    private:
+        static const size_t MAX_DEPTH = sizeof(size_t) * 8;
+
+        size_t size;
+        size_t visited;
+        size_t index;
+        size_t depth;
+        std::array<TreeNode<T>*, MAX_DEPTH> path;
+
+        static size_t levelOf(size_t position) {
+            size_t level = 0;
+
+            while (position >>= 1) {
+                ++level;
+            }
+
+            return level;
+        }
+
+        // In 1-based numbering the bits of a position below its leading one spell
+        // the left/right turns from the root, so only the levels whose bits changed
+        // in the increment have to be re-walked.
+        void advanceLevelOrder() {
+            size_t position = ++index + 1;
+            size_t newDepth = levelOf(position);
+            size_t changed = levelOf(position ^ (position - 1));
+            size_t from = newDepth > changed ? newDepth - changed : 1;
+
+            for (size_t level = from; level <= newDepth; ++level) {
+                bool right = (position >> (newDepth - level)) & 1;
+                path[level] = right ? path[level - 1]->right : path[level - 1]->left;
+            }
+
+            depth = newDepth;
+        }
+
+        void advancePreOrder() {
+            if (2 * index + 1 < size) {
+                path[depth + 1] = path[depth]->left;
+                index = 2 * index + 1;
+                ++depth;
+                return;
+            }
+
+            while (depth > 0 && (index % 2 == 0 || index + 1 >= size)) {
+                index = (index - 1) / 2;
+                --depth;
+            }
+
+            path[depth] = path[depth - 1]->right;
+            ++index;
+        }
+
+        void advanceInOrder() {
+            if (2 * index + 2 < size) {
+                path[depth + 1] = path[depth]->right;
+                index = 2 * index + 2;
+                ++depth;
+                descendLeft();
+                return;
+            }
+
+            while (depth > 0 && index % 2 == 0) {
+                index = (index - 1) / 2;
+                --depth;
+            }
+
+            index = (index - 1) / 2;
+            --depth;
+        }
+
+        void descendLeft() {
+            while (2 * index + 1 < size) {
+                path[depth + 1] = path[depth]->left;
+                index = 2 * index + 1;
+                ++depth;
+            }
+        }
+    };
+
+    template <TraversalOrder Order>
+    class Range {
+    public:
+        Range(TreeNode<T>* root, size_t size) : root(root), size(size) {}
+
+        Iterator<Order> begin() const {
+            return Iterator<Order>(root, size, 0);
+        }
+
+        Iterator<Order> end() const {
+            return Iterator<Order>(root, size, size);
+        }
+
+    private:
+        TreeNode<T>* root;
+        size_t size;
+    };
+
+    using iterator = Iterator<TraversalOrder::LevelOrder>;
+    using const_iterator = iterator;
+
+    // Allocation and operation counts of every tree of this type, all zero
+    // unless built with CONTAINER_INSTRUMENTATION; see instrumentation.h.
+    using Counters = CountersFor<CompleteBinaryTree>;
+
+    static CounterSnapshot counters() {
+        return Counters::snapshot();
+    }
+
+    CompleteBinaryTree() : root(nullptr), count(0), block(nullptr), blockSize(0) {}
+
+    template <typename RandomIt>
+    CompleteBinaryTree(RandomIt first, RandomIt last) : CompleteBinaryTree() {
+        buildFrom(first, last);
+    }
+
+    CompleteBinaryTree(const CompleteBinaryTree&) = delete;
+    CompleteBinaryTree& operator=(const CompleteBinaryTree&) = delete;
+
+    ~CompleteBinaryTree() {
+        destroyNodes();
+    }
+
+    // Replaces the tree with the one that inserting first..last in order would
+    // give. The shape of a complete tree follows from its size, so all nodes
+    // are allocated at once and wired by index arithmetic, with the subtrees
+    // near the root built as tasks on pool.
+    template <typename RandomIt>
+    void buildFrom(RandomIt first, RandomIt last, ThreadPool& pool = ThreadPool::shared()) {
+        static_assert(std::is_base_of_v<std::random_access_iterator_tag,
+                                        typename std::iterator_traits<RandomIt>::iterator_category>,
+                      "buildFrom needs random access to the values");
+
+        build(static_cast<size_t>(last - first), [first](size_t index, size_t) -> decltype(auto) { return first[index]; },
+              pool);
+    }
+
+    void buildFrom(const std::vector<T>& values, ThreadPool& pool = ThreadPool::shared()) {
+        buildFrom(values.begin(), values.end(), pool);
+    }
+
+    // Replaces the tree with a serializeBinary dump like buildFrom does. The
+    // dump is a pre-order walk, the order of the block, so each task reads the
+    // run of the file that holds its subtree; dumps of trivially copyable types
+    // are mapped rather than read. The tree is left as it is if the file
+    // cannot be used.
+    void load(const std::string& filename, ThreadPool& pool = ThreadPool::shared()) {
+        if constexpr (std::is_trivially_copyable_v<T> && sizeof(BinaryHeader) % alignof(T) == 0) {
+            MappedView<T> view(filename);
+
+            if (view.is_open()) {
+                build(view.size(), [&view](size_t, size_t slot) -> const T& { return view[slot]; }, pool);
+            }
+        }
+        else {
+            BinaryReader reader(filename);
+            BinaryHeader header;
+
+            if (!reader.is_open()) {
+                std::cerr << "Unable to open the file for binary deserialization." << std::endl;
+                return;
+            }
+
+            if (!reader.readHeader(header, sizeof(T))) {
+                std::cerr << "Invalid binary header." << std::endl;
+                return;
+            }
+
+            std::vector<T> values;
+            T value;
+
+            while (values.size() < header.count && reader.readValue(value)) {
+                values.push_back(std::move(value));
+            }
+
+            if (values.size() != header.count) {
+                std::cerr << "The binary dump is truncated." << std::endl;
+                return;
+            }
+
+            build(values.size(), [&values](size_t, size_t slot) -> const T& { return values[slot]; }, pool);
+        }
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    iterator begin() const {
+        return iterator(root, count, 0);
+    }
+
+    iterator end() const {
+        return iterator(root, count, count);
+    }
+
+    Range<TraversalOrder::LevelOrder> levelOrder() const {
+        return Range<TraversalOrder::LevelOrder>(root, count);
+    }
+
+    Range<TraversalOrder::PreOrder> preOrder() const {
+        return Range<TraversalOrder::PreOrder>(root, count);
+    }
+
+    Range<TraversalOrder::InOrder> inOrder() const {
+        return Range<TraversalOrder::InOrder>(root, count);
+    }
+
+    template <typename Visitor>
+    void visit(Visitor&& visitor, TraversalOrder order = TraversalOrder::LevelOrder) const {
+        switch (order) {
+        case TraversalOrder::LevelOrder:
+            for (const T& value : levelOrder()) {
+                visitor(value);
+            }
+            break;
+        case TraversalOrder::PreOrder:
+            for (const T& value : preOrder()) {
+                visitor(value);
+            }
+            break;
+        case TraversalOrder::InOrder:
+            for (const T& value : inOrder()) {
+                visitor(value);
+            }
+            break;
+        }
+    }
+
+    // Calls visitor on every element in no particular order. The subtrees near
+    // the root become tasks on pool, so visitor must be safe to call
+    // concurrently. Any pool with size() and a TaskGroup like ThreadPool's
+    // will do.
+    template <typename Visitor, typename Pool = ThreadPool>
+    void parallelVisit(const Visitor& visitor, Pool& pool = ThreadPool::shared()) const {
+        size_t spawnDepth = 0;
+
+        while ((size_t(1) << spawnDepth) < pool.size() * 8) {
+            ++spawnDepth;
+        }
+
+        typename Pool::TaskGroup group(pool);
+        visitSubtree(root, spawnDepth, group, visitor);
+        group.wait();
+    }
+
+    void insert(const T& value) {
+        TreeNode<T>* newNode = new TreeNode<T>(value);
+        Counters::allocated(sizeof(TreeNode<T>));
+        Counters::operation();
+        ++count;
+
+        if (!root) {
+            root = newNode;
+            return;
+        }
+
+        std::queue<TreeNode<T>*> nodesQueue;
+        nodesQueue.push(root);
+
+        while (!nodesQueue.empty()) {
+            TreeNode<T>* current = nodesQueue.front();
+            nodesQueue.pop();
+
+            if (!current->left) {
+                current->left = newNode;
+                return;
+            }
+            else {
+                nodesQueue.push(current->left);
+            }
+
+            if (!current->right) {
+                current->right = newNode;
+                return;
+            }
+            else {
+                nodesQueue.push(current->right);
+            }
+        }
+    }
+
+    void breadthFirstTraversal() const {
+        if (!root) {
+            std::cout << "The tree is empty." << std::endl;
+            return;
+        }
+
+        std::queue<TreeNode<T>*> nodesQueue;
+        nodesQueue.push(root);
+
+        while (!nodesQueue.empty()) {
+            TreeNode<T>* current = nodesQueue.front();
+            nodesQueue.pop();
+
+            std::cout << current->data << " ";
+
+            if (current->left) {
+                nodesQueue.push(current->left);
+            }
+
+            if (current->right) {
+                nodesQueue.push(current->right);
+            }
+        }
+
+        std::cout << std::endl;
+    }
+
+    std::string serializeText() const {
+        std::string text;
+
+        serializeTextHelper(root, text);
+
+        Counters::serialized(text.size());
+        return text;
+    }
+
+    bool serializeText(int fd) const {
+        TextWriter writer(fd);
+
+        serializeTextHelper(root, writer);
+
+        writer.flush();
+        Counters::serialized(writer.bytesWritten());
+        return writer.good();
+    }
+
+    template <typename Sink>
+    void serializeTextHelper(TreeNode<T>* node, Sink& sink) const {
+        if (!node) {
+            appendText(sink, "null ");
+            return;
+        }
+
+        appendText(sink, node->data);
+        appendText(sink, " ");
+        serializeTextHelper(node->left, sink);
+        serializeTextHelper(node->right, sink);
+    }
+
+    // Replaces the tree with the one in data, a pre-order walk with null
+    // markers. Input that does not describe a complete tree is rejected and the
+    // tree is left as it is.
+    void deserializeText(const std::string& data) {
+        TextReader reader(data);
+        TreeNode<T>* loaded = deserializeTextHelper(reader);
+        size_t loadedCount = countNodes(loaded);
+
+        if (!isComplete(loaded, loadedCount)) {
+            releaseSubtree(loaded);
+            std::cerr << "Invalid text serialization: the tree is not complete." << std::endl;
+            return;
+        }
+
+        destroyNodes();
+        root = loaded;
+        count = loadedCount;
+    }
+
+    TreeNode<T>* deserializeTextHelper(TextReader& reader) {
+        std::string_view token;
+        T value;
+
+        if (!reader.nextToken(token) || token == "null" || !parseText(token, value)) {
+            return nullptr;
+        }
+
+        TreeNode<T>* node = new TreeNode<T>(value);
+        Counters::allocated(sizeof(TreeNode<T>));
+        Counters::operation();
+        node->left = deserializeTextHelper(reader);
+        node->right = deserializeTextHelper(reader);
+
+        return node;
+    }
+
+    void serializeBinary(const std::string& filename) const {
+        BinaryWriter writer(filename);
+
+        if (writer.is_open()) {
+            writer.writeHeader(sizeof(T), count);
+            serializeBinaryHelper(root, writer);
+            Counters::serialized(writer.bytesWritten());
+            writer.close();
+        }
+        else {
+            std::cerr << "Unable to open the file for binary serialization." << std::endl;
+        }
+    }
+
+    std::future<bool> serializeBinaryAsync(const std::string& filename, AsyncWriter& writer = AsyncWriter::shared()) const {
+        AsyncWriter::Snapshot snapshot = writer.begin(filename);
+        snapshot.writeHeader(sizeof(T), count);
+        serializeBinaryHelper(root, snapshot);
+        return snapshot.finish();
+    }
+
+    template <typename Sink>
+    void serializeBinaryHelper(TreeNode<T>* node, Sink& sink) const {
+        if (!node) {
+            return;
+        }
+
+        sink.writeValue(node->data);
+        serializeBinaryHelper(node->left, sink);
+        serializeBinaryHelper(node->right, sink);
+    }
+
+    void deserializeBinary(const std::string& filename) {
+        BinaryReader reader(filename);
+
+        if (reader.is_open()) {
+            BinaryHeader header;
+
+            if (!reader.readHeader(header, sizeof(T))) {
+                std::cerr << "Invalid binary header." << std::endl;
+                return;
+            }
+
+            TreeNode<T>* loaded = deserializeBinaryHelper(reader, 0, header.count);
+
+            if (countNodes(loaded) != header.count) {
+                releaseSubtree(loaded);
+                std::cerr << "The binary dump is truncated." << std::endl;
+                return;
+            }
+
+            destroyNodes();
+            root = loaded;
+            count = header.count;
+            reader.close();
+        }
+        else {
+            std::cerr << "Unable to open the file for binary deserialization." << std::endl;
+        }
+    }
+
+    // The payload is a pre-order walk without null markers; the header count
+    // fixes the shape, since node i of a complete tree has children 2i+1 and 2i+2.
+    // A short payload leaves fewer than size nodes.
+    TreeNode<T>* deserializeBinaryHelper(BinaryReader& reader, size_t index, size_t size) {
+        T value;
+
+        if (index >= size || !reader.readValue(value)) {
+            return nullptr;
+        }
+
+        TreeNode<T>* node = new TreeNode<T>(value);
+        Counters::allocated(sizeof(TreeNode<T>));
+        Counters::operation();
+        node->left = deserializeBinaryHelper(reader, 2 * index + 1, size);
+        node->right = deserializeBinaryHelper(reader, 2 * index + 2, size);
+
+        return node;
+    }
+
+    size_t countNodes(TreeNode<T>* node) const {
+        if (!node) {
+            return 0;
+        }
+
+        return 1 + countNodes(node->left) + countNodes(node->right);
+    }
+
+};
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "binaryIO.h"
+
+// Owns an I/O thread and a fixed set of buffers. A snapshot is encoded into one
+// buffer while the I/O thread writes out the others, so the caller only copies
+// memory and blocks only when every buffer is waiting to be written.
+class AsyncWriter {
+public:
+    static constexpr size_t BUFFER_SIZE = 4 << 20;
+
+    explicit AsyncWriter(size_t bufferSize = BUFFER_SIZE, size_t bufferCount = 2)
+        : buffers(bufferCount, std::vector<char>(bufferSize)), stopping(false) {
+        for (size_t index = 0; index < bufferCount; ++index) {
+            freeBuffers.push_back(index);
+        }
+
+        worker = std::thread([this]() { run(); });
+    }
+
+    AsyncWriter(const AsyncWriter&) = delete;
+    AsyncWriter& operator=(const AsyncWriter&) = delete;
+
+    ~AsyncWriter() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+
+        jobReady.notify_one();
+        worker.join();
+    }
+
+    static AsyncWriter& shared() {
+        static AsyncWriter writer;
+        return writer;
+    }
+
+    class Snapshot : public BinarySink<Snapshot> {
+    public:
+        Snapshot(AsyncWriter& owner, const std::string& filename)
+            : owner(owner), state(std::make_shared<State>()), buffer(owner.acquireBuffer()), used(0), finished(false) {
+            std::shared_ptr<State> file = state;
+            owner.submit([file, filename]() {
+                file->fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+                file->ok = file->fd >= 0;
+            });
+        }
+
+        Snapshot(const Snapshot&) = delete;
+        Snapshot& operator=(const Snapshot&) = delete;
+
+        ~Snapshot() {
+            if (!finished) {
+                finish();
+            }
+        }
+
+        void write(const void* data, size_t size) {
+            const char* bytes = static_cast<const char*>(data);
+
+            while (size > 0) {
+                std::vector<char>& target = owner.buffers[buffer];
+                size_t chunk = std::min(size, target.size() - used);
+                std::memcpy(target.data() + used, bytes, chunk);
+                used += chunk;
+                bytes += chunk;
+                size -= chunk;
+
+                if (used == target.size()) {
+                    flushBuffer();
+                    buffer = owner.acquireBuffer();
+                }
+            }
+        }
+
+        // Rewrites the count of the header at the start of the file once the
+        // payload before it has been written.
+        void patchCount(uint64_t count) {
+            patch(offsetof(BinaryHeader, count), &count, sizeof(count));
+        }
+
+        void patch(uint64_t offset, const void* data, size_t size) {
+            flushBuffer();
+            buffer = owner.acquireBuffer();
+
+            std::shared_ptr<State> file = state;
+            std::vector<char> bytes(static_cast<const char*>(data), static_cast<const char*>(data) + size);
+            owner.submit([file, offset, bytes]() {
+                file->ok = file->ok && pwriteAll(file->fd, bytes.data(), bytes.size(), offset);
+            });
+        }
+
+        // Queues the remaining bytes and the close; the future reports whether
+        // every write succeeded.
+        std::future<bool> finish() {
+            flushBuffer();
+            finished = true;
+
+            std::shared_ptr<State> file = state;
+            std::future<bool> result = file->done.get_future();
+            owner.submit([file]() {
+                if (file->fd >= 0) {
+                    file->ok = ::close(file->fd) == 0 && file->ok;
+                }
+
+                file->done.set_value(file->ok);
+            });
+
+            return result;
+        }
+
+    private:
+        struct State {
+            int fd = -1;
+            bool ok = false;
+            std::promise<bool> done;
+        };
+
+        AsyncWriter& owner;
+        std::shared_ptr<State> state;
+        size_t buffer;
+        size_t used;
+        bool finished;
+
+        void flushBuffer() {
+            std::shared_ptr<State> file = state;
+            AsyncWriter* writer = &owner;
+            size_t index = buffer;
+            size_t size = used;
+            used = 0;
+
+            owner.submit([file, writer, index, size]() {
+                const char* data = writer->buffers[index].data();
+                size_t remaining = size;
+
+                while (file->ok && remaining > 0) {
+                    ssize_t result = ::write(file->fd, data, remaining);
+
+                    if (result <= 0) {
+                        file->ok = false;
+                        break;
+                    }
+
+                    data += result;
+                    remaining -= result;
+                }
+
+                writer->releaseBuffer(index);
+            });
+        }
+    };
+
+    Snapshot begin(const std::string& filename) {
+        return Snapshot(*this, filename);
+    }
+
+private:
+    std::vector<std::vector<char>> buffers;
+    std::vector<size_t> freeBuffers;
+    std::deque<std::function<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable jobReady;
+    std::condition_variable bufferReady;
+    bool stopping;
+    std::thread worker;
+
+    void submit(std::function<void()> job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(std::move(job));
+        }
+
+        jobReady.notify_one();
+    }
+
+    size_t acquireBuffer() {
+        std::unique_lock<std::mutex> lock(mutex);
+        bufferReady.wait(lock, [this]() { return !freeBuffers.empty(); });
+
+        size_t index = freeBuffers.back();
+        freeBuffers.pop_back();
+        return index;
+    }
+
+    void releaseBuffer(size_t index) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            freeBuffers.push_back(index);
+        }
+
+        bufferReady.notify_one();
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        while (true) {
+            jobReady.wait(lock, [this]() { return stopping || !jobs.empty(); });
+
+            if (jobs.empty()) {
+                return;
+            }
+
+            std::function<void()> job = std::move(jobs.front());
+            jobs.pop_front();
+
+            lock.unlock();
+            job();
+            lock.lock();
+        }
+    }
+};
@@ -0,0 +1,213 @@
+#include <benchmark/benchmark.h>
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <queue>
+#include <vector>
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <cstddef>
+#include <atomic>
+#include <numeric>
+#include "CBT.h"
+#include "centralQueuePool.h"
+
+static void BM_Insert(benchmark::State& state) {
+    CompleteBinaryTree<int> myTree;
+
+    for (auto _ : state) {
+        myTree.insert(42);
+    }
+}
+BENCHMARK(BM_Insert);
+
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override {
+        return c;
+    }
+};
+
+static void BM_BreadthFirstTraversal(benchmark::State& state) {
+    CompleteBinaryTree<int> myTree;
+
+    for (int value = 0; value < state.range(0); ++value) {
+        myTree.insert(value);
+    }
+
+    NullBuffer nullBuffer;
+    std::streambuf* original = std::cout.rdbuf(&nullBuffer);
+
+    for (auto _ : state) {
+        myTree.breadthFirstTraversal();
+    }
+
+    std::cout.rdbuf(original);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_BreadthFirstTraversal)->Range(8, 1 << 14);
+
+static void BM_LevelOrderIterator(benchmark::State& state) {
+    CompleteBinaryTree<int> myTree;
+
+    for (int value = 0; value < state.range(0); ++value) {
+        myTree.insert(value);
+    }
+
+    NullBuffer nullBuffer;
+    std::ostream out(&nullBuffer);
+
+    for (auto _ : state) {
+        for (int value : myTree) {
+            out << value << " ";
+        }
+        out << std::endl;
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_LevelOrderIterator)->Range(8, 1 << 14);
+
+static void BM_LevelOrderSum(benchmark::State& state) {
+    CompleteBinaryTree<int> myTree;
+
+    for (int value = 0; value < state.range(0); ++value) {
+        myTree.insert(value);
+    }
+
+    for (auto _ : state) {
+        long long sum = 0;
+        myTree.visit([&](int value) { sum += value; });
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_LevelOrderSum)->Range(8, 1 << 14);
+
+// Parallel for over the tree with a few hundred nanoseconds of work per node,
+// serially, on the work-stealing pool and on the central mutex Queue.
+static uint64_t nodeWork(int value) {
+    uint64_t hash = value;
+
+    for (int round = 0; round < 256; ++round) {
+        hash = hash * 6364136223846793005ULL + 1442695040888963407ULL;
+    }
+
+    return hash;
+}
+
+static void BM_VisitWork(benchmark::State& state) {
+    CompleteBinaryTree<int> myTree;
+
+    for (int value = 0; value < state.range(0); ++value) {
+        myTree.insert(value);
+    }
+
+    for (auto _ : state) {
+        myTree.visit([](int value) { benchmark::DoNotOptimize(nodeWork(value)); });
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_VisitWork)->Range(1 << 10, 1 << 14)->UseRealTime();
+
+static void BM_ParallelVisitWork(benchmark::State& state) {
+    CompleteBinaryTree<int> myTree;
+
+    for (int value = 0; value < state.range(0); ++value) {
+        myTree.insert(value);
+    }
+
+    for (auto _ : state) {
+        myTree.parallelVisit([](int value) { benchmark::DoNotOptimize(nodeWork(value)); });
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ParallelVisitWork)->Range(1 << 10, 1 << 14)->UseRealTime();
+
+static void BM_ParallelVisitWorkCentralQueue(benchmark::State& state) {
+    CompleteBinaryTree<int> myTree;
+    CentralQueuePool pool;
+
+    for (int value = 0; value < state.range(0); ++value) {
+        myTree.insert(value);
+    }
+
+    for (auto _ : state) {
+        myTree.parallelVisit([](int value) { benchmark::DoNotOptimize(nodeWork(value)); }, pool);
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ParallelVisitWorkCentralQueue)->Range(1 << 10, 1 << 14)->UseRealTime();
+
+// Bulk construction against building the same tree node by node. insert walks
+// the tree breadth-first to find the free slot, so repeated insert is quadratic
+// and only runs up to sizes it finishes in.
+static void BM_InsertRepeated(benchmark::State& state) {
+    for (auto _ : state) {
+        CompleteBinaryTree<int> myTree;
+
+        for (int value = 0; value < state.range(0); ++value) {
+            myTree.insert(value);
+        }
+
+        benchmark::DoNotOptimize(myTree.size());
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_InsertRepeated)->Range(1 << 10, 1 << 14)->Unit(benchmark::kMillisecond);
+
+static void BM_BuildFrom(benchmark::State& state) {
+    std::vector<int> values(state.range(0));
+    std::iota(values.begin(), values.end(), 0);
+
+    for (auto _ : state) {
+        CompleteBinaryTree<int> myTree;
+        myTree.buildFrom(values);
+        benchmark::DoNotOptimize(myTree.size());
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_BuildFrom)->Arg(1 << 10)->Arg(1 << 14)->Arg(1 << 20)->Arg(10000000)->Arg(100000000)
+    ->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_DeserializeBinary(benchmark::State& state) {
+    std::vector<int> values(state.range(0));
+    std::iota(values.begin(), values.end(), 0);
+    CompleteBinaryTree<int> source(values.begin(), values.end());
+    source.serializeBinary("binary_tree_data.bin");
+
+    for (auto _ : state) {
+        CompleteBinaryTree<int> myTree;
+        myTree.deserializeBinary("binary_tree_data.bin");
+        benchmark::DoNotOptimize(myTree.size());
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_DeserializeBinary)->Arg(1 << 20)->Arg(10000000)->Arg(100000000)
+    ->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_Load(benchmark::State& state) {
+    std::vector<int> values(state.range(0));
+    std::iota(values.begin(), values.end(), 0);
+    CompleteBinaryTree<int> source(values.begin(), values.end());
+    source.serializeBinary("binary_tree_data.bin");
+
+    for (auto _ : state) {
+        CompleteBinaryTree<int> myTree;
+        myTree.load("binary_tree_data.bin");
+        benchmark::DoNotOptimize(myTree.size());
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Load)->Arg(1 << 20)->Arg(10000000)->Arg(100000000)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
\ No newline at end of file
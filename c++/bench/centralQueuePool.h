@@ -0,0 +1,136 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+#include "queue.h"
+
+// Baseline scheduler for the work-stealing ThreadPool in the benchmarks: every
+// task goes through one Queue guarded by a mutex. Same size() and TaskGroup
+// interface, so fork-join code can run on either.
+class CentralQueuePool {
+public:
+    explicit CentralQueuePool(size_t threads = std::thread::hardware_concurrency()) : stopping(false) {
+        threads = std::max<size_t>(threads, 1);
+
+        for (size_t index = 0; index < threads; ++index) {
+            workers.emplace_back([this]() { work(); });
+        }
+    }
+
+    CentralQueuePool(const CentralQueuePool&) = delete;
+    CentralQueuePool& operator=(const CentralQueuePool&) = delete;
+
+    size_t size() const {
+        return workers.size();
+    }
+
+    ~CentralQueuePool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+
+        taskReady.notify_all();
+
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    class TaskGroup {
+    public:
+        explicit TaskGroup(CentralQueuePool& pool) : pool(pool), pending(0) {}
+
+        ~TaskGroup() {
+            wait();
+        }
+
+        template <typename Work>
+        void run(Work&& work) {
+            pending.fetch_add(1, std::memory_order_relaxed);
+            pool.submit(new Task{std::function<void()>(std::forward<Work>(work)), this});
+        }
+
+        void wait() {
+            while (pending.load(std::memory_order_acquire) != 0) {
+                if (!pool.runPending()) {
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+    private:
+        friend class CentralQueuePool;
+
+        CentralQueuePool& pool;
+        std::atomic<size_t> pending;
+    };
+
+private:
+    struct Task {
+        std::function<void()> work;
+        TaskGroup* group;
+    };
+
+    Queue<Task*> tasks;
+    std::mutex mutex;
+    std::condition_variable taskReady;
+    bool stopping;
+    std::vector<std::thread> workers;
+
+    void submit(Task* task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push(task);
+        }
+
+        taskReady.notify_one();
+    }
+
+    static void execute(Task* task) {
+        task->work();
+        task->group->pending.fetch_sub(1, std::memory_order_release);
+        delete task;
+    }
+
+    bool runPending() {
+        std::optional<Task*> task;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            task = tasks.tryPop();
+        }
+
+        if (!task) {
+            return false;
+        }
+
+        execute(*task);
+        return true;
+    }
+
+    void work() {
+        while (true) {
+            Task* task = nullptr;
+
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                taskReady.wait(lock, [this]() { return stopping || !tasks.isEmpty(); });
+
+                if (tasks.isEmpty()) {
+                    return;
+                }
+
+                task = *tasks.tryPop();
+            }
+
+            execute(task);
+        }
+    }
+};
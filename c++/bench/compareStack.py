@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+"""Puts the C++ and Rust stack benchmarks side by side.
+
+Reads the google-benchmark JSON written by
+    stackBench --benchmark_filter=BM_Cross --benchmark_out=<json>
+and the criterion results that `cargo bench` leaves under rust/target/criterion,
+and prints the time per run of every workload and size in both languages.
+
+Usage: compareStack.py <stackBench json> <criterion directory>
+"""
+
+import json
+import os
+import sys
+
+UNITS = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}
+WORKLOADS = ["push", "serialize_text", "deserialize_text", "serialize_binary", "deserialize_binary"]
+
+
+def cppName(workload):
+    return "BM_Cross" + "".join(part.capitalize() for part in workload.split("_"))
+
+
+def readCpp(path):
+    with open(path) as file:
+        report = json.load(file)
+
+    times = {}
+
+    for run in report["benchmarks"]:
+        if run.get("run_type", "iteration") == "iteration":
+            times[run["name"]] = run["real_time"] * UNITS[run["time_unit"]]
+
+    return times
+
+
+def readRust(directory, workload, size):
+    path = os.path.join(directory, workload, str(size), "new", "estimates.json")
+
+    if not os.path.exists(path):
+        return None
+
+    with open(path) as file:
+        return json.load(file)["mean"]["point_estimate"]
+
+
+def sizesOf(times, workload):
+    prefix = cppName(workload) + "/"
+    return sorted(int(name[len(prefix):]) for name in times if name.startswith(prefix))
+
+
+def formatTime(nanoseconds):
+    if nanoseconds is None:
+        return "-"
+
+    for unit in ("s", "ms", "us"):
+        if nanoseconds >= UNITS[unit]:
+            return "%.2f %s" % (nanoseconds / UNITS[unit], unit)
+
+    return "%.0f ns" % nanoseconds
+
+
+def main(arguments):
+    if len(arguments) != 3:
+        sys.stderr.write(__doc__)
+        return 2
+
+    cpp = readCpp(arguments[1])
+    print("%-20s %10s %12s %12s %8s" % ("workload", "size", "C++", "Rust", "C++/Rust"))
+
+    for workload in WORKLOADS:
+        for size in sizesOf(cpp, workload):
+            cppTime = cpp["%s/%d" % (cppName(workload), size)]
+            rustTime = readRust(arguments[2], workload, size)
+            ratio = "%.2f" % (cppTime / rustTime) if rustTime else "-"
+            print("%-20s %10d %12s %12s %8s" % (workload, size, formatTime(cppTime), formatTime(rustTime), ratio))
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,597 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <istream>
+#include <list>
+#include <memory>
+#include <ostream>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include "binaryIO.h"
+#include "instrumentation.h"
+#include "latencyHistogram.h"
+#include "perfCounters.h"
+
+// Every container against the std:: containers that would replace it, on the
+// same operations, sizes and payloads:
+//   Push          build a container of state.range(0) elements and destroy it
+//   PushPop       build it and drain it again
+//   Lookup        find existing keys in a container of that size
+//   Traversal     visit every element once
+//   Serialization write a binary dump and load it back
+//   PushPopLatency, LookupLatency
+//                 percentiles of single pushes, pops and lookups, each timed
+//                 on its own
+// Items are elements, so results of different sizes can be compared directly.
+// Run with --benchmark_out=<file> --benchmark_out_format=json (or build the
+// benchmark_json target) to keep results that can be diffed between releases.
+// The containerBenchmarksInstrumented build of this file also reports the
+// containers' counters (see instrumentation.h) for the timed loop. Pass
+// --perf_counters to add cycles, instructions, L1D and LLC misses and branch
+// misses per iteration; they are left out where perf_event_open is not allowed.
+
+// Set by --perf_counters.
+static bool perfCountersRequested = false;
+
+// 64-byte trivially copyable payload, ordered and hashed by its first word.
+struct Pod64 {
+    uint64_t words[8];
+
+    bool operator==(const Pod64& other) const {
+        return std::equal(words, words + 8, other.words);
+    }
+
+    bool operator!=(const Pod64& other) const {
+        return !(*this == other);
+    }
+
+    bool operator<(const Pod64& other) const {
+        return words[0] < other.words[0];
+    }
+};
+
+std::ostream& operator<<(std::ostream& os, const Pod64& value) {
+    return os << value.words[0];
+}
+
+std::istream& operator>>(std::istream& is, Pod64& value) {
+    is >> value.words[0];
+    std::fill(value.words + 1, value.words + 8, value.words[0]);
+    return is;
+}
+
+template <>
+struct std::hash<Pod64> {
+    size_t operator()(const Pod64& value) const {
+        return std::hash<uint64_t>()(value.words[0]);
+    }
+};
+
+#include "stack.h"
+#include "queue.h"
+#include "list.h"
+#include "doublyList.h"
+#include "hashTable.h"
+#include "CBT.h"
+
+// The i-th distinct value of each payload, increasing with i. Strings are long
+// enough to live on the heap.
+template <typename T>
+T makeValue(int64_t i);
+
+template <>
+int makeValue<int>(int64_t i) {
+    return static_cast<int>(i);
+}
+
+template <>
+Pod64 makeValue<Pod64>(int64_t i) {
+    Pod64 value;
+    std::fill(value.words, value.words + 8, static_cast<uint64_t>(i));
+    return value;
+}
+
+template <>
+std::string makeValue<std::string>(int64_t i) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "value-%020lld", static_cast<long long>(i));
+    return text;
+}
+
+template <typename T>
+static const std::vector<T>& valuesFor(int64_t count) {
+    static std::vector<T> values;
+
+    if (static_cast<int64_t>(values.size()) != count) {
+        values.clear();
+        values.shrink_to_fit();
+
+        for (int64_t i = 0; i < count; ++i) {
+            values.push_back(makeValue<T>(i));
+        }
+    }
+
+    return values;
+}
+
+// Something cheap to fold over while traversing.
+static uint64_t weigh(int value) {
+    return value;
+}
+
+static uint64_t weigh(const Pod64& value) {
+    return value.words[0];
+}
+
+static uint64_t weigh(const std::string& value) {
+    return value.size();
+}
+
+// Adapters giving each container the same operations.
+struct StackOps {
+    template <typename T> using Container = Stack<T>;
+
+    template <typename T> static void add(Stack<T>& c, const T& value) { c.push(value); }
+    template <typename T> static void remove(Stack<T>& c) { c.pop(); }
+    template <typename T, typename F> static void traverse(const Stack<T>& c, F f) { c.visit(f); }
+    template <typename T> static void save(const Stack<T>& c, const std::string& file) { c.serializeBinary(file); }
+    template <typename T> static void load(Stack<T>& c, const std::string& file) { c.deserializeBinary(file); }
+};
+
+struct QueueOps {
+    template <typename T> using Container = Queue<T>;
+
+    template <typename T> static void add(Queue<T>& c, const T& value) { c.push(value); }
+    template <typename T> static void remove(Queue<T>& c) { c.pop(); }
+    template <typename T, typename F> static void traverse(const Queue<T>& c, F f) { c.visit(f); }
+    template <typename T> static void save(const Queue<T>& c, const std::string& file) { c.serializeBinary(file); }
+    template <typename T> static void load(Queue<T>& c, const std::string& file) { c.deserializeBinary(file); }
+};
+
+struct ListOps {
+    template <typename T> using Container = List<T>;
+
+    template <typename T> static void add(List<T>& c, const T& value) { c.push(value); }
+    template <typename T, typename F> static void traverse(const List<T>& c, F f) { c.visit(f); }
+    template <typename T> static void save(const List<T>& c, const std::string& file) { c.serializeBinary(file); }
+    template <typename T> static void load(List<T>& c, const std::string& file) { c.deserializeBinary(file); }
+};
+
+struct DoublyListOps {
+    template <typename T> using Container = DoublyList<T>;
+
+    template <typename T> static void add(DoublyList<T>& c, const T& value) { c.append(value); }
+    template <typename T, typename F> static void traverse(const DoublyList<T>& c, F f) { c.visit(f); }
+    template <typename T> static void save(const DoublyList<T>& c, const std::string& file) { c.serializeBinary(file); }
+    template <typename T> static void load(DoublyList<T>& c, const std::string& file) { c.deserializeBinary(file); }
+};
+
+struct OrderedListOps {
+    template <typename T> using Container = OrderedList<T>;
+
+    template <typename T> static void add(OrderedList<T>& c, const T& value) { c.insert(value); }
+    template <typename T> static bool contains(const OrderedList<T>& c, const T& key) { return c.find(key) != nullptr; }
+};
+
+struct HashTableOps {
+    template <typename T> using Container = HashTable<T, int64_t>;
+
+    template <typename T> static void add(HashTable<T, int64_t>& c, const T& key) { c.insert(key, 0); }
+    template <typename T> static bool contains(const HashTable<T, int64_t>& c, const T& key) { return c.find(key).has_value(); }
+    template <typename T> static void save(const HashTable<T, int64_t>& c, const std::string& file) { c.serializeBinary(file); }
+    template <typename T> static void load(HashTable<T, int64_t>& c, const std::string& file) { c.deserializeBinary(file); }
+};
+
+// Inserting into the tree walks it from the root each time, so it is built by
+// loading a dump instead, which takes linear time.
+struct TreeOps {
+    template <typename T> using Container = CompleteBinaryTree<T>;
+
+    template <typename T>
+    static void fill(CompleteBinaryTree<T>& c, const std::vector<T>& values) {
+        BinaryWriter writer("bench_tree_fill.bin");
+        writer.writeHeader(sizeof(T), values.size());
+
+        for (const T& value : values) {
+            writer.writeValue(value);
+        }
+
+        writer.close();
+        c.deserializeBinary("bench_tree_fill.bin");
+    }
+
+    template <typename T, typename F> static void traverse(const CompleteBinaryTree<T>& c, F f) { c.visit(f); }
+    template <typename T> static void save(const CompleteBinaryTree<T>& c, const std::string& file) { c.serializeBinary(file); }
+    template <typename T> static void load(CompleteBinaryTree<T>& c, const std::string& file) { c.deserializeBinary(file); }
+};
+
+struct VectorOps {
+    template <typename T> using Container = std::vector<T>;
+
+    template <typename T> static void add(std::vector<T>& c, const T& value) { c.push_back(value); }
+    template <typename T> static void remove(std::vector<T>& c) { c.pop_back(); }
+    template <typename T, typename F> static void traverse(const std::vector<T>& c, F f) { std::for_each(c.begin(), c.end(), f); }
+
+    // Baseline dump in the same format, written and read element by element.
+    template <typename T>
+    static void save(const std::vector<T>& c, const std::string& file) {
+        BinaryWriter writer(file);
+        writer.writeHeader(sizeof(T), c.size());
+
+        for (const T& value : c) {
+            writer.writeValue(value);
+        }
+
+        writer.close();
+    }
+
+    template <typename T>
+    static void load(std::vector<T>& c, const std::string& file) {
+        BinaryReader reader(file);
+        BinaryHeader header;
+
+        if (reader.readHeader(header, sizeof(T))) {
+            c.resize(header.count);
+
+            for (T& value : c) {
+                reader.readValue(value);
+            }
+        }
+    }
+};
+
+struct DequeOps {
+    template <typename T> using Container = std::deque<T>;
+
+    template <typename T> static void add(std::deque<T>& c, const T& value) { c.push_back(value); }
+    template <typename T> static void remove(std::deque<T>& c) { c.pop_front(); }
+    template <typename T, typename F> static void traverse(const std::deque<T>& c, F f) { std::for_each(c.begin(), c.end(), f); }
+};
+
+struct StdListOps {
+    template <typename T> using Container = std::list<T>;
+
+    template <typename T> static void add(std::list<T>& c, const T& value) { c.push_back(value); }
+    template <typename T> static void remove(std::list<T>& c) { c.pop_front(); }
+    template <typename T, typename F> static void traverse(const std::list<T>& c, F f) { std::for_each(c.begin(), c.end(), f); }
+};
+
+struct UnorderedMapOps {
+    template <typename T> using Container = std::unordered_map<T, int64_t>;
+
+    template <typename T> static void add(std::unordered_map<T, int64_t>& c, const T& key) { c.emplace(key, 0); }
+    template <typename T> static bool contains(const std::unordered_map<T, int64_t>& c, const T& key) { return c.find(key) != c.end(); }
+};
+
+template <typename Ops, typename T>
+static void fill(typename Ops::template Container<T>& c, const std::vector<T>& values) {
+    if constexpr (std::is_same_v<Ops, TreeOps>) {
+        Ops::fill(c, values);
+    }
+    else {
+        for (const T& value : values) {
+            Ops::add(c, value);
+        }
+    }
+}
+
+// The containers of this tree have counters(); the std:: ones do not.
+template <typename C, typename = void>
+struct HasCounters : std::false_type {};
+
+template <typename C>
+struct HasCounters<C, std::void_t<decltype(C::counters())>> : std::true_type {};
+
+// Everything a timed loop is measured by besides time, reported per iteration
+// when the loop ends: in instrumented builds the counters of the containers
+// (live bytes being what is still held at the end, which is the container
+// under test for the benchmarks that build it outside the loop), and with
+// --perf_counters the hardware counters of the benchmark thread.
+template <typename C>
+class LoopCounters {
+public:
+    explicit LoopCounters(benchmark::State& state) : state(state) {
+        if constexpr (HasCounters<C>::value) {
+            before = C::counters();
+        }
+
+        if (perfCountersRequested) {
+            perf = std::make_unique<PerfCounters>();
+            perf->start();
+        }
+    }
+
+    void report() {
+        if (perf) {
+            perf->stop();
+            std::array<PerfCounters::Event, PerfCounters::EVENTS> events = PerfCounters::events();
+
+            for (size_t index = 0; index < PerfCounters::EVENTS; ++index) {
+                if (perf->has(index)) {
+                    state.counters[events[index].name] = benchmark::Counter(perf->value(index), benchmark::Counter::kAvgIterations);
+                }
+            }
+        }
+
+        if constexpr (INSTRUMENTATION_ENABLED && HasCounters<C>::value) {
+            CounterSnapshot after = C::counters();
+            CounterSnapshot loop = after - before;
+
+            state.counters["allocs_per_op"] = loop.allocationsPerOperation();
+            state.counters["bytes_allocated"] = benchmark::Counter(loop[Counter::BytesAllocated], benchmark::Counter::kAvgIterations);
+            state.counters["live_bytes"] = after[Counter::LiveBytes];
+
+            if (loop[Counter::SerializedBytes] > 0) {
+                state.counters["serialized_bytes"] = benchmark::Counter(loop[Counter::SerializedBytes], benchmark::Counter::kAvgIterations);
+            }
+
+            if (loop[Counter::Lookups] > 0) {
+                state.counters["probes_per_lookup"] = loop.probesPerLookup();
+            }
+        }
+    }
+
+private:
+    benchmark::State& state;
+    CounterSnapshot before;
+    std::unique_ptr<PerfCounters> perf;
+};
+
+// Reports the percentiles of a latency histogram, in nanoseconds, as
+// <name>_p50 ... <name>_max.
+static void reportLatency(benchmark::State& state, const std::string& name, const LatencyHistogram& histogram) {
+    state.counters[name + "_p50"] = histogram.percentile(0.5);
+    state.counters[name + "_p90"] = histogram.percentile(0.9);
+    state.counters[name + "_p99"] = histogram.percentile(0.99);
+    state.counters[name + "_p999"] = histogram.percentile(0.999);
+    state.counters[name + "_max"] = histogram.max();
+}
+
+template <typename Ops, typename T>
+static void BM_Push(benchmark::State& state) {
+    const std::vector<T>& values = valuesFor<T>(state.range(0));
+
+    LoopCounters<typename Ops::template Container<T>> counters(state);
+
+    for (auto _ : state) {
+        typename Ops::template Container<T> c;
+        fill<Ops>(c, values);
+        benchmark::ClobberMemory();
+    }
+
+    counters.report();
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <typename Ops, typename T>
+static void BM_PushPop(benchmark::State& state) {
+    const std::vector<T>& values = valuesFor<T>(state.range(0));
+    typename Ops::template Container<T> c;
+
+    LoopCounters<typename Ops::template Container<T>> counters(state);
+
+    for (auto _ : state) {
+        fill<Ops>(c, values);
+
+        for (size_t i = 0; i < values.size(); ++i) {
+            Ops::remove(c);
+        }
+
+        benchmark::ClobberMemory();
+    }
+
+    counters.report();
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <typename Ops, typename T>
+static void BM_Lookup(benchmark::State& state) {
+    const std::vector<T>& values = valuesFor<T>(state.range(0));
+    typename Ops::template Container<T> c;
+    fill<Ops>(c, values);
+
+    std::mt19937_64 random(42);
+    std::vector<size_t> probes(4096);
+
+    for (size_t& probe : probes) {
+        probe = random() % values.size();
+    }
+
+    size_t next = 0;
+
+    LoopCounters<typename Ops::template Container<T>> counters(state);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(Ops::contains(c, values[probes[next++ & 4095]]));
+    }
+
+    counters.report();
+    state.SetItemsProcessed(state.iterations());
+}
+
+template <typename Ops, typename T>
+static void BM_Traversal(benchmark::State& state) {
+    const std::vector<T>& values = valuesFor<T>(state.range(0));
+    typename Ops::template Container<T> c;
+    fill<Ops>(c, values);
+
+    LoopCounters<typename Ops::template Container<T>> counters(state);
+
+    for (auto _ : state) {
+        uint64_t sum = 0;
+        Ops::traverse(c, [&sum](const T& value) { sum += weigh(value); });
+        benchmark::DoNotOptimize(sum);
+    }
+
+    counters.report();
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <typename Ops, typename T>
+static void BM_Serialization(benchmark::State& state) {
+    const std::vector<T>& values = valuesFor<T>(state.range(0));
+    typename Ops::template Container<T> c;
+    fill<Ops>(c, values);
+
+    LoopCounters<typename Ops::template Container<T>> counters(state);
+
+    for (auto _ : state) {
+        Ops::save(c, "bench_suite.bin");
+
+        typename Ops::template Container<T> loaded;
+        Ops::load(loaded, "bench_suite.bin");
+        benchmark::ClobberMemory();
+    }
+
+    counters.report();
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Every push and every pop of an iteration, which pushes state.range(0)
+// elements and pops them all again, is timed and recorded separately.
+template <typename Ops, typename T>
+static void BM_PushPopLatency(benchmark::State& state) {
+    const std::vector<T>& values = valuesFor<T>(state.range(0));
+    typename Ops::template Container<T> c;
+    LatencyHistogram pushes;
+    LatencyHistogram pops;
+    LoopCounters<typename Ops::template Container<T>> counters(state);
+
+    for (auto _ : state) {
+        for (const T& value : values) {
+            pushes.record(OperationTimer::time([&c, &value]() { Ops::add(c, value); }));
+        }
+
+        for (size_t i = 0; i < values.size(); ++i) {
+            pops.record(OperationTimer::time([&c]() { Ops::remove(c); }));
+        }
+    }
+
+    counters.report();
+    reportLatency(state, "push", pushes);
+    reportLatency(state, "pop", pops);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// One lookup of an existing key per iteration, each recorded.
+template <typename Ops, typename T>
+static void BM_LookupLatency(benchmark::State& state) {
+    const std::vector<T>& values = valuesFor<T>(state.range(0));
+    typename Ops::template Container<T> c;
+    fill<Ops>(c, values);
+
+    std::mt19937_64 random(42);
+    std::vector<size_t> probes(4096);
+
+    for (size_t& probe : probes) {
+        probe = random() % values.size();
+    }
+
+    size_t next = 0;
+    LatencyHistogram lookups;
+    LoopCounters<typename Ops::template Container<T>> counters(state);
+
+    for (auto _ : state) {
+        const T& key = values[probes[next++ & 4095]];
+        lookups.record(OperationTimer::time([&c, &key]() { benchmark::DoNotOptimize(Ops::contains(c, key)); }));
+    }
+
+    counters.report();
+    reportLatency(state, "lookup", lookups);
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Sizes from 8 to 1 << 24 elements in steps of 8. The 64-byte and string
+// payloads stop at 1 << 22 so that the hash tables, which hold up to three
+// times their entries while growing or loading, stay within a few GB.
+#define SIZES_int ->Range(8, 1 << 24)
+#define SIZES_Pod64 ->Range(8, 1 << 22)
+#define SIZES_string ->Range(8, 1 << 22)
+
+#define REGISTER(bench, ops)                                               \
+    BENCHMARK_TEMPLATE(bench, ops, int) SIZES_int->UseRealTime();          \
+    BENCHMARK_TEMPLATE(bench, ops, Pod64) SIZES_Pod64->UseRealTime();      \
+    BENCHMARK_TEMPLATE(bench, ops, std::string) SIZES_string->UseRealTime()
+
+REGISTER(BM_Push, StackOps);
+REGISTER(BM_Push, QueueOps);
+REGISTER(BM_Push, ListOps);
+REGISTER(BM_Push, DoublyListOps);
+REGISTER(BM_Push, HashTableOps);
+REGISTER(BM_Push, VectorOps);
+REGISTER(BM_Push, DequeOps);
+REGISTER(BM_Push, StdListOps);
+REGISTER(BM_Push, UnorderedMapOps);
+
+REGISTER(BM_PushPop, StackOps);
+REGISTER(BM_PushPop, QueueOps);
+REGISTER(BM_PushPop, VectorOps);
+REGISTER(BM_PushPop, DequeOps);
+REGISTER(BM_PushPop, StdListOps);
+
+REGISTER(BM_Lookup, HashTableOps);
+REGISTER(BM_Lookup, OrderedListOps);
+REGISTER(BM_Lookup, UnorderedMapOps);
+
+REGISTER(BM_Traversal, StackOps);
+REGISTER(BM_Traversal, QueueOps);
+REGISTER(BM_Traversal, ListOps);
+REGISTER(BM_Traversal, DoublyListOps);
+REGISTER(BM_Traversal, TreeOps);
+REGISTER(BM_Traversal, VectorOps);
+REGISTER(BM_Traversal, DequeOps);
+REGISTER(BM_Traversal, StdListOps);
+
+REGISTER(BM_Serialization, StackOps);
+REGISTER(BM_Serialization, QueueOps);
+REGISTER(BM_Serialization, ListOps);
+REGISTER(BM_Serialization, DoublyListOps);
+REGISTER(BM_Serialization, HashTableOps);
+REGISTER(BM_Serialization, TreeOps);
+REGISTER(BM_Serialization, VectorOps);
+
+// A cache-resident and a memory-resident size for the latency benchmarks.
+#define REGISTER_LATENCY(bench, ops)                                                        \
+    BENCHMARK_TEMPLATE(bench, ops, int)->Arg(1 << 10)->Arg(1 << 20)->UseRealTime();         \
+    BENCHMARK_TEMPLATE(bench, ops, std::string)->Arg(1 << 10)->Arg(1 << 20)->UseRealTime()
+
+REGISTER_LATENCY(BM_PushPopLatency, StackOps);
+REGISTER_LATENCY(BM_PushPopLatency, QueueOps);
+REGISTER_LATENCY(BM_PushPopLatency, VectorOps);
+REGISTER_LATENCY(BM_PushPopLatency, DequeOps);
+
+REGISTER_LATENCY(BM_LookupLatency, HashTableOps);
+REGISTER_LATENCY(BM_LookupLatency, OrderedListOps);
+REGISTER_LATENCY(BM_LookupLatency, UnorderedMapOps);
+
+// BENCHMARK_MAIN, plus the --perf_counters flag.
+int main(int argc, char** argv) {
+    int kept = 1;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "--perf_counters") {
+            perfCountersRequested = true;
+        }
+        else {
+            argv[kept++] = argv[i];
+        }
+    }
+
+    argc = kept;
+    benchmark::Initialize(&argc, argv);
+
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,207 @@
+#include <benchmark/benchmark.h>
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "doublyList.h"
+
+static void BM_Append(benchmark::State& state) {
+    DoublyList<int> myList;
+
+    for (auto _ : state) {
+        myList.append(42);
+    }
+}
+BENCHMARK(BM_Append);
+
+static void BM_SerializeText(benchmark::State& state) {
+    DoublyList<int> myList;
+
+    myList.append(1);
+    myList.append(2);
+    myList.append(3);
+
+    for (auto _ : state) {
+        std::string serializedData = myList.serializeText();
+        benchmark::DoNotOptimize(serializedData);
+    }
+}
+BENCHMARK(BM_SerializeText);
+
+static void BM_DeserializeText(benchmark::State& state) {
+    DoublyList<int> myList;
+
+    myList.append(1);
+    myList.append(2);
+    myList.append(3);
+
+    std::string serializedData = myList.serializeText();
+
+    for (auto _ : state) {
+        DoublyList<int> newList;
+        newList.deserializeText(serializedData);
+        benchmark::DoNotOptimize(newList);
+    }
+}
+BENCHMARK(BM_DeserializeText);
+
+static const int LARGE_PAYLOAD = 10000000;
+
+static void BM_SerializeTextLarge(benchmark::State& state) {
+    DoublyList<int> myList;
+
+    for (int i = 0; i < LARGE_PAYLOAD; ++i) {
+        myList.append(i * 37);
+    }
+
+    for (auto _ : state) {
+        std::string serializedData = myList.serializeText();
+        benchmark::DoNotOptimize(serializedData);
+    }
+
+    state.SetItemsProcessed(state.iterations() * LARGE_PAYLOAD);
+}
+BENCHMARK(BM_SerializeTextLarge)->Unit(benchmark::kMillisecond);
+
+static void BM_SerializeTextToFd(benchmark::State& state) {
+    DoublyList<int> myList;
+
+    for (int i = 0; i < LARGE_PAYLOAD; ++i) {
+        myList.append(i * 37);
+    }
+
+    for (auto _ : state) {
+        int fd = ::open("text_data.txt", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        myList.serializeText(fd);
+        ::close(fd);
+    }
+
+    state.SetItemsProcessed(state.iterations() * LARGE_PAYLOAD);
+}
+BENCHMARK(BM_SerializeTextToFd)->Unit(benchmark::kMillisecond);
+
+// The formatting cost of the previous std::ostringstream implementation, for comparison.
+static void BM_SerializeTextStreamBaseline(benchmark::State& state) {
+    for (auto _ : state) {
+        std::ostringstream oss;
+
+        for (int i = 0; i < LARGE_PAYLOAD; ++i) {
+            oss << i * 37 << " ";
+        }
+
+        std::string serializedData = oss.str();
+        benchmark::DoNotOptimize(serializedData);
+    }
+
+    state.SetItemsProcessed(state.iterations() * LARGE_PAYLOAD);
+}
+BENCHMARK(BM_SerializeTextStreamBaseline)->Unit(benchmark::kMillisecond);
+
+static void BM_DeserializeTextLarge(benchmark::State& state) {
+    DoublyList<int> myList;
+
+    for (int i = 0; i < LARGE_PAYLOAD; ++i) {
+        myList.append(i * 37);
+    }
+
+    std::string serializedData = myList.serializeText();
+
+    for (auto _ : state) {
+        DoublyList<int> newList;
+        newList.deserializeText(serializedData);
+        benchmark::DoNotOptimize(newList);
+    }
+
+    state.SetItemsProcessed(state.iterations() * LARGE_PAYLOAD);
+}
+BENCHMARK(BM_DeserializeTextLarge)->Unit(benchmark::kMillisecond);
+
+static void BM_SerializeBinary(benchmark::State& state) {
+    DoublyList<int> myList;
+
+    myList.append(1);
+    myList.append(2);
+    myList.append(3);
+
+    for (auto _ : state) {
+        myList.serializeBinary("binary_data.bin");
+    }
+}
+BENCHMARK(BM_SerializeBinary);
+
+static void BM_DeserializeBinary(benchmark::State& state) {
+    DoublyList<int> myList;
+
+    myList.append(1);
+    myList.append(2);
+    myList.append(3);
+
+    myList.serializeBinary("binary_data.bin");
+
+    for (auto _ : state) {
+        DoublyList<int> newList;
+        newList.deserializeBinary("binary_data.bin");
+        benchmark::DoNotOptimize(newList);
+    }
+}
+BENCHMARK(BM_DeserializeBinary);
+
+// Sorting state.range(0) random ints in place, against copying them into a
+// std::vector, sorting that and building a new list. The list is shuffled
+// again, untimed, before every run.
+static uint32_t scramble(int value) {
+    uint32_t hash = static_cast<uint32_t>(value) * 2654435761u;
+    return hash ^ (hash >> 16);
+}
+
+static void BM_Sort(benchmark::State& state) {
+    DoublyList<int> myList;
+    std::mt19937 random(1);
+
+    for (int i = 0; i < state.range(0); ++i) {
+        myList.append(random() % 1000000);
+    }
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        myList.sort([](int a, int b) { return scramble(a) < scramble(b); });
+        state.ResumeTiming();
+
+        myList.sort();
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Sort)->Arg(1 << 16)->Arg(1 << 20)->Arg(10000000)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_SortViaVector(benchmark::State& state) {
+    DoublyList<int> myList;
+    std::mt19937 random(1);
+
+    for (int i = 0; i < state.range(0); ++i) {
+        myList.append(random() % 1000000);
+    }
+
+    for (auto _ : state) {
+        std::vector<int> values;
+        myList.visit([&](int value) { values.push_back(value); });
+        std::stable_sort(values.begin(), values.end());
+
+        DoublyList<int> sorted;
+
+        for (int value : values) {
+            sorted.append(value);
+        }
+
+        benchmark::DoNotOptimize(sorted);
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SortViaVector)->Arg(1 << 16)->Arg(1 << 20)->Arg(10000000)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
\ No newline at end of file
@@ -0,0 +1,239 @@
+#include <benchmark/benchmark.h>
+#include <iostream>
+#include <vector>
+#include <sstream>
+#include <fstream>
+#include <algorithm>
+#include <thread>
+#include <optional>
+#include <random>
+#include <fcntl.h>
+#include <unistd.h>
+#include "hashTable.h"
+
+static void BM_Insert(benchmark::State& state) {
+    HashTable<std::string, int> myHashTable;
+
+    for (auto _ : state) {
+        myHashTable.insert("key", 42); 
+    }
+}
+BENCHMARK(BM_Insert);
+
+static void BM_Get(benchmark::State& state) {
+    HashTable<std::string, int> myHashTable;
+    myHashTable.insert("key", 42);
+
+    for (auto _ : state) {
+        int value = myHashTable.get("key");
+        benchmark::DoNotOptimize(value);
+    }
+}
+BENCHMARK(BM_Get);
+
+static void BM_GetMiss(benchmark::State& state) {
+    HashTable<std::string, int> myHashTable;
+    myHashTable.insert("key", 42);
+
+    for (auto _ : state) {
+        int value = myHashTable.get("missing");
+        benchmark::DoNotOptimize(value);
+    }
+}
+BENCHMARK(BM_GetMiss);
+
+static void BM_FindMiss(benchmark::State& state) {
+    HashTable<std::string, int> myHashTable;
+    myHashTable.insert("key", 42);
+
+    for (auto _ : state) {
+        std::optional<int> value = myHashTable.find("missing");
+        benchmark::DoNotOptimize(value);
+    }
+}
+BENCHMARK(BM_FindMiss);
+
+static void fillTable(HashTable<int64_t, int64_t>& myHashTable, int64_t entries) {
+    myHashTable.reserve(entries);
+
+    for (int64_t key = 0; key < entries; ++key) {
+        myHashTable.insert(key * 2654435761LL, key);
+    }
+}
+
+static int64_t missRatioKey(int64_t i, int64_t) {
+    return i * 2654435761LL;
+}
+
+static std::string missRatioKey(int64_t i, const std::string&) {
+    return "dedup-key-" + std::to_string(i * 2654435761LL);
+}
+
+// Lookups in a table of 1 << 22 entries of which range(0) percent miss, without
+// (range(1) == 0) and with the filter in front.
+template <typename Key>
+static void BM_FindMissRatio(benchmark::State& state) {
+    const int64_t entries = 1 << 22;
+    HashTable<Key, int64_t> myHashTable;
+    myHashTable.reserve(entries);
+
+    for (int64_t i = 0; i < entries; ++i) {
+        myHashTable.insert(missRatioKey(i, Key()), i);
+    }
+
+    if (state.range(1)) {
+        myHashTable.enableFilter();
+    }
+
+    std::mt19937_64 random(42);
+    std::vector<Key> keys(1 << 20);
+
+    for (Key& key : keys) {
+        bool miss = static_cast<int64_t>(random() % 100) < state.range(0);
+        key = missRatioKey(static_cast<int64_t>(random() % entries) + (miss ? entries : 0), Key());
+    }
+
+    size_t next = 0;
+
+    for (auto _ : state) {
+        std::optional<int64_t> value = myHashTable.find(keys[next++ & (keys.size() - 1)]);
+        benchmark::DoNotOptimize(value);
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_FindMissRatio, int64_t)->ArgsProduct({ { 0, 25, 50, 75, 90, 99 }, { 0, 1 } });
+BENCHMARK_TEMPLATE(BM_FindMissRatio, std::string)->ArgsProduct({ { 0, 25, 50, 75, 90, 99 }, { 0, 1 } });
+
+// Keys with lengths like those of identifiers, e-mail addresses and URLs:
+// 40% of 6-15 bytes, 45% of 16-40 and 15% of 41-100.
+static std::vector<std::string> realisticKeys(size_t count) {
+    std::mt19937_64 random(7);
+    std::vector<std::string> keys(count);
+
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t kind = random() % 100;
+        size_t length = kind < 40 ? 6 + random() % 10 : kind < 85 ? 16 + random() % 25 : 41 + random() % 60;
+        std::string key = std::to_string(i) + '/';
+
+        while (key.size() < length) {
+            key += static_cast<char>('a' + random() % 26);
+        }
+
+        keys[i] = key;
+    }
+
+    return keys;
+}
+
+// Hits at random among range(0) string keys of realistic lengths, with the
+// memory the table holds per entry.
+static void BM_FindStringKeys(benchmark::State& state) {
+    std::vector<std::string> keys = realisticKeys(state.range(0));
+    HashTable<std::string, int> myHashTable;
+    myHashTable.reserve(keys.size());
+
+    for (size_t i = 0; i < keys.size(); ++i) {
+        myHashTable.insert(keys[i], static_cast<int>(i));
+    }
+
+    std::mt19937_64 random(42);
+    std::vector<size_t> order(1 << 20);
+
+    for (size_t& index : order) {
+        index = random() % keys.size();
+    }
+
+    size_t next = 0;
+
+    for (auto _ : state) {
+        std::optional<int> value = myHashTable.find(keys[order[next++ & (order.size() - 1)]]);
+        benchmark::DoNotOptimize(value);
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    state.counters["bytes_per_entry"] = static_cast<double>(myHashTable.bytes()) / myHashTable.size();
+}
+BENCHMARK(BM_FindStringKeys)->Arg(1 << 16)->Arg(1 << 20)->Arg(1 << 22);
+
+// Hits at random among range(0) entries, in the mutable table (range(1) == 0)
+// and in its frozen copy, which reads one slot per lookup.
+static void BM_FindFrozen(benchmark::State& state) {
+    HashTable<int64_t, int64_t> myHashTable;
+    fillTable(myHashTable, state.range(0));
+    FrozenHashTable<int64_t, int64_t> frozen;
+
+    if (state.range(1)) {
+        frozen = myHashTable.freeze();
+    }
+
+    std::mt19937_64 random(42);
+    std::vector<int64_t> keys(1 << 20);
+
+    for (int64_t& key : keys) {
+        key = static_cast<int64_t>(random() % state.range(0)) * 2654435761LL;
+    }
+
+    size_t next = 0;
+
+    for (auto _ : state) {
+        int64_t key = keys[next++ & (keys.size() - 1)];
+        std::optional<int64_t> value = state.range(1) ? frozen.find(key) : myHashTable.find(key);
+        benchmark::DoNotOptimize(value);
+    }
+
+    state.SetItemsProcessed(state.iterations());
+
+    if (state.range(1)) {
+        state.counters["bytes_per_entry"] = static_cast<double>(frozen.bytes()) / frozen.size();
+    }
+}
+BENCHMARK(BM_FindFrozen)->ArgsProduct({ { 1 << 20, 10000000, 100000000 }, { 0, 1 } });
+
+static void BM_Freeze(benchmark::State& state) {
+    HashTable<int64_t, int64_t> myHashTable;
+    fillTable(myHashTable, state.range(0));
+
+    for (auto _ : state) {
+        FrozenHashTable<int64_t, int64_t> frozen = myHashTable.freeze();
+        benchmark::DoNotOptimize(frozen);
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Freeze)->Arg(1 << 20)->Arg(10000000)->Unit(benchmark::kMillisecond);
+
+static void BM_SerializeBinaryThreads(benchmark::State& state) {
+    HashTable<int64_t, int64_t> myHashTable;
+    fillTable(myHashTable, state.range(0));
+
+    for (auto _ : state) {
+        myHashTable.serializeBinary("binary_file.bin", state.range(1));
+    }
+
+    state.SetBytesProcessed(state.iterations() * state.range(0) * 2 * sizeof(int64_t));
+}
+BENCHMARK(BM_SerializeBinaryThreads)
+    ->ArgsProduct({ { 1 << 20, 50000000 }, { 1, 2, 4, 8, 16 } })
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+static void BM_DeserializeBinaryThreads(benchmark::State& state) {
+    HashTable<int64_t, int64_t> myHashTable;
+    fillTable(myHashTable, state.range(0));
+    myHashTable.serializeBinary("binary_file.bin", state.range(1));
+
+    for (auto _ : state) {
+        HashTable<int64_t, int64_t> newHashTable;
+        newHashTable.deserializeBinary("binary_file.bin", state.range(1));
+        benchmark::DoNotOptimize(newHashTable);
+    }
+
+    state.SetBytesProcessed(state.iterations() * state.range(0) * 2 * sizeof(int64_t));
+}
+BENCHMARK(BM_DeserializeBinaryThreads)
+    ->ArgsProduct({ { 1 << 20, 50000000 }, { 1, 2, 4, 8, 16 } })
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
\ No newline at end of file
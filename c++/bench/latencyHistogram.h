@@ -0,0 +1,141 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+// Log-linear histogram of latencies in nanoseconds, in the style of
+// HdrHistogram: values below 2 * SUB_BUCKETS are counted exactly, and every
+// power of two above that is split into SUB_BUCKETS linear buckets, so any
+// recorded value is reported within 1 / SUB_BUCKETS (about 3%) of itself.
+// Recording is an index computation and an increment, cheap enough to do for
+// every operation of a benchmark.
+class LatencyHistogram {
+public:
+    static constexpr unsigned SUB_BUCKET_BITS = 5;
+    static constexpr uint64_t SUB_BUCKETS = uint64_t(1) << SUB_BUCKET_BITS;
+    static constexpr size_t BUCKETS = 2 * SUB_BUCKETS + (64 - SUB_BUCKET_BITS - 1) * SUB_BUCKETS;
+
+    LatencyHistogram() : total(0), sum(0), largest(0) {
+        counts.fill(0);
+    }
+
+    void record(uint64_t nanoseconds) {
+        ++counts[bucketOf(nanoseconds)];
+        ++total;
+        sum += nanoseconds;
+        largest = std::max(largest, nanoseconds);
+    }
+
+    void merge(const LatencyHistogram& other) {
+        for (size_t bucket = 0; bucket < BUCKETS; ++bucket) {
+            counts[bucket] += other.counts[bucket];
+        }
+
+        total += other.total;
+        sum += other.sum;
+        largest = std::max(largest, other.largest);
+    }
+
+    void clear() {
+        *this = LatencyHistogram();
+    }
+
+    uint64_t count() const {
+        return total;
+    }
+
+    double mean() const {
+        return total == 0 ? 0.0 : static_cast<double>(sum) / total;
+    }
+
+    uint64_t max() const {
+        return largest;
+    }
+
+    // The smallest value that at least fraction of the recorded values do not
+    // exceed, as the highest value of its bucket; e.g. 0.999 for p99.9.
+    uint64_t percentile(double fraction) const {
+        if (total == 0) {
+            return 0;
+        }
+
+        uint64_t rank = static_cast<uint64_t>(std::ceil(fraction * total));
+        rank = std::clamp<uint64_t>(rank, 1, total);
+        uint64_t seen = 0;
+
+        for (size_t bucket = 0; bucket < BUCKETS; ++bucket) {
+            seen += counts[bucket];
+
+            if (seen >= rank) {
+                return std::min(highestIn(bucket), largest);
+            }
+        }
+
+        return largest;
+    }
+
+    static size_t bucketOf(uint64_t value) {
+        if (value < 2 * SUB_BUCKETS) {
+            return value;
+        }
+
+        unsigned shift = 63 - __builtin_clzll(value) - SUB_BUCKET_BITS;
+        return 2 * SUB_BUCKETS + (shift - 1) * SUB_BUCKETS + ((value >> shift) - SUB_BUCKETS);
+    }
+
+    static uint64_t highestIn(size_t bucket) {
+        if (bucket < 2 * SUB_BUCKETS) {
+            return bucket;
+        }
+
+        unsigned shift = (bucket - 2 * SUB_BUCKETS) / SUB_BUCKETS + 1;
+        uint64_t first = ((bucket - 2 * SUB_BUCKETS) % SUB_BUCKETS + SUB_BUCKETS) << shift;
+        return first + ((uint64_t(1) << shift) - 1);
+    }
+
+private:
+    std::array<uint64_t, BUCKETS> counts;
+    uint64_t total;
+    uint64_t sum;
+    uint64_t largest;
+};
+
+// Times single operations with steady_clock. The cost of reading the clock
+// twice, measured once as the smallest of many back-to-back readings, is taken
+// off every sample, so what remains is the operation itself within the clock's
+// jitter.
+class OperationTimer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static uint64_t overhead() {
+        static const uint64_t measured = measureOverhead();
+        return measured;
+    }
+
+    template <typename Operation>
+    static uint64_t time(Operation&& operation) {
+        Clock::time_point start = Clock::now();
+        operation();
+        Clock::time_point end = Clock::now();
+        uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        return elapsed > overhead() ? elapsed - overhead() : 0;
+    }
+
+private:
+    static uint64_t measureOverhead() {
+        uint64_t smallest = std::numeric_limits<uint64_t>::max();
+
+        for (int sample = 0; sample < 10000; ++sample) {
+            Clock::time_point start = Clock::now();
+            Clock::time_point end = Clock::now();
+            smallest = std::min<uint64_t>(smallest, std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+        }
+
+        return smallest;
+    }
+};
@@ -0,0 +1,351 @@
+#include <benchmark/benchmark.h>
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <numeric>
+#include <array>
+#include <atomic>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <new>
+#include <random>
+#include <thread>
+#include "list.h"
+
+static void BM_Push(benchmark::State& state) {
+    List<int> myList;
+
+    for (auto _ : state) {
+        myList.push(42); 
+    }
+}
+BENCHMARK(BM_Push);
+
+static void BM_DeserializeBinary(benchmark::State& state) {
+    List<int64_t> myList;
+
+    for (int64_t i = 0; i < state.range(0); ++i) {
+        myList.push(i);
+    }
+
+    myList.serializeBinary("binary_data_list.bin");
+
+    for (auto _ : state) {
+        List<int64_t> newList;
+        newList.deserializeBinary("binary_data_list.bin");
+        benchmark::DoNotOptimize(newList);
+    }
+
+    state.SetBytesProcessed(state.iterations() * state.range(0) * sizeof(int64_t));
+}
+BENCHMARK(BM_DeserializeBinary)->Range(1 << 10, 1 << 22);
+
+static void BM_MappedViewOpen(benchmark::State& state) {
+    List<int64_t> myList;
+
+    for (int64_t i = 0; i < state.range(0); ++i) {
+        myList.push(i);
+    }
+
+    myList.serializeBinary("binary_data_list.bin");
+
+    for (auto _ : state) {
+        ListView<int64_t> view("binary_data_list.bin");
+        benchmark::DoNotOptimize(view.size());
+    }
+
+    state.SetBytesProcessed(state.iterations() * state.range(0) * sizeof(int64_t));
+}
+BENCHMARK(BM_MappedViewOpen)->Range(1 << 10, 1 << 22);
+
+static void BM_MappedViewScan(benchmark::State& state) {
+    List<int64_t> myList;
+
+    for (int64_t i = 0; i < state.range(0); ++i) {
+        myList.push(i);
+    }
+
+    myList.serializeBinary("binary_data_list.bin");
+
+    for (auto _ : state) {
+        ListView<int64_t> view("binary_data_list.bin");
+        int64_t sum = std::accumulate(view.begin(), view.end(), int64_t(0));
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetBytesProcessed(state.iterations() * state.range(0) * sizeof(int64_t));
+}
+BENCHMARK(BM_MappedViewScan)->Range(1 << 10, 1 << 22);
+
+// Lookups of random keys (half of them missing) among state.range(0) even keys:
+// the skip-list index, a linear walk of List, and std::map.
+static std::vector<int64_t> makeProbes(int64_t keys) {
+    std::mt19937_64 random(42);
+    std::vector<int64_t> probes(4096);
+
+    for (int64_t& probe : probes) {
+        probe = random() % (keys * 2);
+    }
+
+    return probes;
+}
+
+static void BM_OrderedListFind(benchmark::State& state) {
+    OrderedList<int64_t> myList;
+
+    for (int64_t i = 0; i < state.range(0); ++i) {
+        myList.insert(i * 2);
+    }
+
+    std::vector<int64_t> probes = makeProbes(state.range(0));
+    size_t next = 0;
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(myList.find(probes[next++ & 4095]));
+    }
+}
+BENCHMARK(BM_OrderedListFind)->Arg(1 << 10)->Arg(1 << 20)->Arg(10000000);
+
+static void BM_LinearFind(benchmark::State& state) {
+    List<int64_t> myList;
+
+    for (int64_t i = 0; i < state.range(0); ++i) {
+        myList.push(i * 2);
+    }
+
+    std::vector<int64_t> probes = makeProbes(state.range(0));
+    size_t next = 0;
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(myList.find(probes[next++ & 4095]));
+    }
+}
+BENCHMARK(BM_LinearFind)->Arg(1 << 10)->Arg(1 << 20)->Arg(10000000);
+
+static void BM_MapFind(benchmark::State& state) {
+    std::map<int64_t, int64_t> myMap;
+
+    for (int64_t i = 0; i < state.range(0); ++i) {
+        myMap.emplace_hint(myMap.end(), i * 2, i * 2);
+    }
+
+    std::vector<int64_t> probes = makeProbes(state.range(0));
+    size_t next = 0;
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(myMap.find(probes[next++ & 4095]));
+    }
+}
+BENCHMARK(BM_MapFind)->Arg(1 << 10)->Arg(1 << 20)->Arg(10000000);
+
+// Inserting state.range(0) keys in random order.
+static void BM_OrderedListInsert(benchmark::State& state) {
+    std::vector<int64_t> keys(state.range(0));
+    std::mt19937_64 random(3);
+
+    for (int64_t& key : keys) {
+        key = random();
+    }
+
+    for (auto _ : state) {
+        OrderedList<int64_t> myList;
+
+        for (int64_t key : keys) {
+            myList.insert(key);
+        }
+
+        benchmark::DoNotOptimize(myList.size());
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_OrderedListInsert)->Arg(1 << 16)->Arg(1 << 20);
+
+static void BM_MapInsert(benchmark::State& state) {
+    std::vector<int64_t> keys(state.range(0));
+    std::mt19937_64 random(3);
+
+    for (int64_t& key : keys) {
+        key = random();
+    }
+
+    for (auto _ : state) {
+        std::map<int64_t, int64_t> myMap;
+
+        for (int64_t key : keys) {
+            myMap.emplace(key, key);
+        }
+
+        benchmark::DoNotOptimize(myMap.size());
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_MapInsert)->Arg(1 << 16)->Arg(1 << 20);
+
+// Summing a 1000-key range out of 10M.
+static void BM_OrderedListRangeScan(benchmark::State& state) {
+    static OrderedList<int64_t> myList;
+
+    if (myList.isEmpty()) {
+        for (int64_t i = 0; i < 10000000; ++i) {
+            myList.insert(i);
+        }
+    }
+
+    std::vector<int64_t> probes = makeProbes(5000000 - 1000);
+    size_t next = 0;
+
+    for (auto _ : state) {
+        int64_t low = probes[next++ & 4095];
+        int64_t sum = 0;
+
+        for (int64_t value : myList.range(low, low + 1000)) {
+            sum += value;
+        }
+
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetItemsProcessed(state.iterations() * 1000);
+}
+BENCHMARK(BM_OrderedListRangeScan);
+
+static void BM_MapRangeScan(benchmark::State& state) {
+    static std::map<int64_t, int64_t> myMap;
+
+    if (myMap.empty()) {
+        for (int64_t i = 0; i < 10000000; ++i) {
+            myMap.emplace_hint(myMap.end(), i, i);
+        }
+    }
+
+    std::vector<int64_t> probes = makeProbes(5000000 - 1000);
+    size_t next = 0;
+
+    for (auto _ : state) {
+        int64_t low = probes[next++ & 4095];
+        int64_t sum = 0;
+
+        for (auto it = myMap.lower_bound(low), last = myMap.lower_bound(low + 1000); it != last; ++it) {
+            sum += it->second;
+        }
+
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetItemsProcessed(state.iterations() * 1000);
+}
+BENCHMARK(BM_MapRangeScan);
+
+// Sorting state.range(0) random ints in place, against copying them into a
+// std::vector, sorting that and building a new list. The list is shuffled
+// again, untimed, before every run.
+static uint32_t scramble(int value) {
+    uint32_t hash = static_cast<uint32_t>(value) * 2654435761u;
+    return hash ^ (hash >> 16);
+}
+
+static void BM_Sort(benchmark::State& state) {
+    List<int> myList;
+    std::mt19937 random(1);
+
+    for (int i = 0; i < state.range(0); ++i) {
+        myList.push(random() % 1000000);
+    }
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        myList.sort([](int a, int b) { return scramble(a) < scramble(b); });
+        state.ResumeTiming();
+
+        myList.sort();
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Sort)->Arg(1 << 16)->Arg(1 << 20)->Arg(10000000)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_SortViaVector(benchmark::State& state) {
+    List<int> myList;
+    std::mt19937 random(1);
+
+    for (int i = 0; i < state.range(0); ++i) {
+        myList.push(random() % 1000000);
+    }
+
+    for (auto _ : state) {
+        std::vector<int> values;
+        myList.visit([&](int value) { values.push_back(value); });
+        std::stable_sort(values.begin(), values.end());
+
+        List<int> sorted;
+
+        for (int value : values) {
+            sorted.push(value);
+        }
+
+        benchmark::DoNotOptimize(sorted);
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SortViaVector)->Arg(1 << 16)->Arg(1 << 20)->Arg(10000000)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// unique and reverse over 10M sorted elements, against the vector round trip.
+static void BM_UniqueReverse(benchmark::State& state) {
+    for (auto _ : state) {
+        state.PauseTiming();
+        List<int> myList;
+
+        for (int i = 0; i < 10000000; ++i) {
+            myList.push(i / 4);
+        }
+
+        state.ResumeTiming();
+
+        myList.unique();
+        myList.reverse();
+        benchmark::DoNotOptimize(myList);
+
+        state.PauseTiming();
+        myList.clear();
+        state.ResumeTiming();
+    }
+}
+BENCHMARK(BM_UniqueReverse)->Unit(benchmark::kMillisecond);
+
+static void BM_UniqueReverseViaVector(benchmark::State& state) {
+    for (auto _ : state) {
+        state.PauseTiming();
+        List<int> myList;
+
+        for (int i = 0; i < 10000000; ++i) {
+            myList.push(i / 4);
+        }
+
+        state.ResumeTiming();
+
+        std::vector<int> values;
+        myList.visit([&](int value) { values.push_back(value); });
+        values.erase(std::unique(values.begin(), values.end()), values.end());
+        std::reverse(values.begin(), values.end());
+
+        List<int> rebuilt;
+
+        for (int value : values) {
+            rebuilt.push(value);
+        }
+
+        benchmark::DoNotOptimize(rebuilt);
+
+        state.PauseTiming();
+        myList.clear();
+        rebuilt.clear();
+        state.ResumeTiming();
+    }
+}
+BENCHMARK(BM_UniqueReverseViaVector)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
\ No newline at end of file
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Hardware counters of the calling thread, read with perf_event_open(2). Each
+// event is opened on its own, so the ones the kernel or CPU does not support
+// (or perf_event_paranoid forbids) are left out while the rest still count;
+// with none available the object does nothing. Only user-space execution is
+// counted, which unprivileged processes may do up to perf_event_paranoid 2.
+class PerfCounters {
+public:
+    struct Event {
+        const char* name;
+        uint32_t type;
+        uint64_t config;
+    };
+
+    static constexpr size_t EVENTS = 5;
+
+    static constexpr std::array<Event, EVENTS> events() {
+        return {{
+            {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {"l1d_misses", PERF_TYPE_HW_CACHE,
+             PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+            {"llc_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+            {"branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        }};
+    }
+
+    PerfCounters() {
+        std::array<Event, EVENTS> wanted = events();
+
+        for (size_t index = 0; index < EVENTS; ++index) {
+            perf_event_attr attributes;
+            std::memset(&attributes, 0, sizeof(attributes));
+            attributes.size = sizeof(attributes);
+            attributes.type = wanted[index].type;
+            attributes.config = wanted[index].config;
+            attributes.disabled = 1;
+            attributes.exclude_kernel = 1;
+            attributes.exclude_hv = 1;
+            attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+            fds[index] = static_cast<int>(::syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+        }
+
+        if (!available()) {
+            warnOnce();
+        }
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    ~PerfCounters() {
+        for (int fd : fds) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+    }
+
+    bool available() const {
+        for (int fd : fds) {
+            if (fd >= 0) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool has(size_t index) const {
+        return fds[index] >= 0;
+    }
+
+    void start() {
+        for (int fd : fds) {
+            if (fd >= 0) {
+                ::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+    }
+
+    void stop() {
+        for (int fd : fds) {
+            if (fd >= 0) {
+                ::ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            }
+        }
+    }
+
+    // Counted value of event index since start(). When more events are open
+    // than the CPU has counters, the kernel time-shares them and the count is
+    // scaled up to the whole interval.
+    double value(size_t index) const {
+        uint64_t data[3] = {0, 0, 0};
+
+        if (fds[index] < 0 || ::read(fds[index], data, sizeof(data)) != sizeof(data) || data[2] == 0) {
+            return 0.0;
+        }
+
+        return static_cast<double>(data[0]) * data[1] / data[2];
+    }
+
+private:
+    std::array<int, EVENTS> fds;
+
+    static void warnOnce() {
+        static bool warned = false;
+
+        if (!warned) {
+            warned = true;
+            std::cerr << "Hardware counters are not available (perf_event_open failed); "
+                         "check /proc/sys/kernel/perf_event_paranoid." << std::endl;
+        }
+    }
+};
@@ -0,0 +1,324 @@
+#include <benchmark/benchmark.h>
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <limits>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "queue.h"
+#include "centralQueuePool.h"
+
+// Fork-join Fibonacci; below the cutoff each call is computed serially.
+static uint64_t serialFib(int n) {
+    return n < 2 ? n : serialFib(n - 1) + serialFib(n - 2);
+}
+
+template <typename Pool>
+static uint64_t parallelFib(Pool& pool, int n, int cutoff) {
+    if (n <= cutoff) {
+        return serialFib(n);
+    }
+
+    uint64_t left = 0;
+    typename Pool::TaskGroup group(pool);
+    group.run([&pool, &left, n, cutoff]() { left = parallelFib(pool, n - 1, cutoff); });
+    uint64_t right = parallelFib(pool, n - 2, cutoff);
+    group.wait();
+    return left + right;
+}
+
+static void BM_Push(benchmark::State& state) {
+    Queue<int> myQueue;
+
+    for (auto _ : state) {
+        myQueue.push(42);
+    }
+}
+BENCHMARK(BM_Push);
+
+// Push a batch of state.range(0) elements and drain it again, node-based versus
+// the inline ring.
+static void BM_PushPopBatch(benchmark::State& state) {
+    Queue<int> myQueue;
+
+    for (auto _ : state) {
+        for (int i = 0; i < state.range(0); ++i) {
+            myQueue.push(i);
+        }
+
+        for (int i = 0; i < state.range(0); ++i) {
+            myQueue.pop();
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_PushPopBatch)->Arg(1)->Arg(16)->Arg(256)->Arg(4096);
+
+// The same batches through pushRange and popInto.
+static void BM_PushRangePopIntoBatch(benchmark::State& state) {
+    Queue<int> myQueue;
+    std::vector<int> batch(state.range(0));
+
+    for (int i = 0; i < state.range(0); ++i) {
+        batch[i] = i;
+    }
+
+    for (auto _ : state) {
+        myQueue.pushRange(batch.data(), batch.size());
+        myQueue.popInto(batch.data(), batch.size());
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_PushRangePopIntoBatch)->Arg(1)->Arg(16)->Arg(256)->Arg(4096);
+
+static void BM_PushRangeDrainBatch(benchmark::State& state) {
+    Queue<int> myQueue;
+    std::vector<int> batch(state.range(0), 42);
+    int64_t sum = 0;
+
+    for (auto _ : state) {
+        myQueue.pushRange(batch.data(), batch.size());
+        myQueue.drain([&sum](int value) { sum += value; });
+    }
+
+    benchmark::DoNotOptimize(sum);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_PushRangeDrainBatch)->Arg(1)->Arg(16)->Arg(256)->Arg(4096);
+
+static void BM_StaticPushPopBatch(benchmark::State& state) {
+    static StaticQueue<int, 4096> myQueue;
+
+    for (auto _ : state) {
+        for (int i = 0; i < state.range(0); ++i) {
+            myQueue.push(i);
+        }
+
+        for (int i = 0; i < state.range(0); ++i) {
+            myQueue.pop();
+        }
+
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_StaticPushPopBatch)->Arg(1)->Arg(16)->Arg(256)->Arg(4096);
+
+static void BM_StaticPushRangePopIntoBatch(benchmark::State& state) {
+    static StaticQueue<int, 4096> myQueue;
+    std::vector<int> batch(state.range(0), 42);
+
+    for (auto _ : state) {
+        myQueue.pushRange(batch.data(), batch.size());
+        myQueue.popInto(batch.data(), batch.size());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_StaticPushRangePopIntoBatch)->Arg(1)->Arg(16)->Arg(256)->Arg(4096);
+
+// Polling an empty queue: the previous behaviour (a line to stderr per miss,
+// here sent to /dev/null), the hook-free pop/read, and tryPop.
+static void BM_EmptyPollLogged(benchmark::State& state) {
+    Queue<int> myQueue;
+    int savedStderr = ::dup(2);
+    int devNull = ::open("/dev/null", O_WRONLY);
+    ::dup2(devNull, 2);
+    setDiagnosticHook(logToStderr);
+
+    for (auto _ : state) {
+        myQueue.pop();
+        benchmark::DoNotOptimize(myQueue.read());
+    }
+
+    setDiagnosticHook(nullptr);
+    ::dup2(savedStderr, 2);
+    ::close(devNull);
+    ::close(savedStderr);
+}
+BENCHMARK(BM_EmptyPollLogged);
+
+static void BM_EmptyPoll(benchmark::State& state) {
+    Queue<int> myQueue;
+
+    for (auto _ : state) {
+        myQueue.pop();
+        benchmark::DoNotOptimize(myQueue.read());
+    }
+}
+BENCHMARK(BM_EmptyPoll);
+
+static void BM_EmptyTryPoll(benchmark::State& state) {
+    Queue<int> myQueue;
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(myQueue.tryPop());
+    }
+}
+BENCHMARK(BM_EmptyTryPoll);
+
+// Arg 0: journaling off; 1: journal without fsync; 2: fdatasync per group commit.
+static void BM_PushPopJournal(benchmark::State& state) {
+    std::filesystem::remove_all("journal_bench");
+    std::filesystem::create_directory("journal_bench");
+
+    Queue<int64_t> myQueue;
+
+    if (state.range(0) > 0) {
+        FsyncPolicy policy = state.range(0) == 2 ? FsyncPolicy::OnCommit : FsyncPolicy::Never;
+        myQueue.openJournal("journal_bench/queue", { static_cast<size_t>(state.range(1)), policy });
+    }
+
+    int64_t id = 0;
+
+    for (auto _ : state) {
+        myQueue.push(id++);
+        myQueue.pop();
+    }
+
+    myQueue.closeJournal();
+    state.SetItemsProcessed(state.iterations() * 2);
+}
+BENCHMARK(BM_PushPopJournal)->Args({ 0, 0 })->Args({ 1, 256 })->Args({ 2, 1 })->Args({ 2, 256 })->Args({ 2, 4096 });
+
+static size_t fileSize(const std::string& filename) {
+    struct stat info;
+    return ::stat(filename.c_str(), &info) == 0 ? info.st_size : 0;
+}
+
+// Mostly increasing IDs with occasional jumps, the shape of our work-queue dumps.
+static Queue<int64_t> makeIdQueue(int64_t count) {
+    Queue<int64_t> myQueue;
+    int64_t id = 1000000000;
+
+    for (int64_t i = 0; i < count; ++i) {
+        id += (i % 64 == 0) ? 5000 : 1 + i % 3;
+        myQueue.push(id);
+    }
+
+    return myQueue;
+}
+
+static void BM_SerializeBinaryEncoding(benchmark::State& state) {
+    Queue<int64_t> myQueue = makeIdQueue(state.range(0));
+    BinaryEncoding encoding = static_cast<BinaryEncoding>(state.range(1));
+
+    for (auto _ : state) {
+        myQueue.serializeBinary("binary_data_queue.bin", encoding);
+    }
+
+    state.SetBytesProcessed(state.iterations() * state.range(0) * sizeof(int64_t));
+    state.counters["file_bytes_per_element"] = double(fileSize("binary_data_queue.bin")) / state.range(0);
+}
+BENCHMARK(BM_SerializeBinaryEncoding)->ArgsProduct({ { 1 << 16, 1 << 22 }, { 0, 1 } });
+
+static void BM_DeserializeBinaryEncoding(benchmark::State& state) {
+    makeIdQueue(state.range(0)).serializeBinary("binary_data_queue.bin", static_cast<BinaryEncoding>(state.range(1)));
+
+    for (auto _ : state) {
+        Queue<int64_t> newQueue;
+        newQueue.deserializeBinary("binary_data_queue.bin");
+        benchmark::DoNotOptimize(newQueue);
+    }
+
+    state.SetBytesProcessed(state.iterations() * state.range(0) * sizeof(int64_t));
+}
+BENCHMARK(BM_DeserializeBinaryEncoding)->ArgsProduct({ { 1 << 16, 1 << 22 }, { 0, 1 } });
+
+// Decode speed alone, without building nodes: the compressed payload is
+// decoded into a reused block, the raw one is read into it directly.
+static void BM_DecodePayload(benchmark::State& state) {
+    BinaryEncoding encoding = static_cast<BinaryEncoding>(state.range(1));
+    makeIdQueue(state.range(0)).serializeBinary("binary_data_queue.bin", encoding);
+    std::vector<int64_t> block(4096);
+
+    for (auto _ : state) {
+        BinaryReader reader("binary_data_queue.bin");
+        BinaryHeader header;
+        reader.read(&header, sizeof(header));
+
+        if (encoding == BinaryEncoding::DeltaVarint) {
+            DeltaVarintDecoder<int64_t> decoder;
+            decoder.read(reader, header.count);
+
+            while (decoder.next(block.data(), block.size()) > 0) {
+                benchmark::DoNotOptimize(block.data());
+            }
+        }
+        else {
+            for (uint64_t read = 0; read < header.count; read += block.size()) {
+                reader.readArray(block.data(), std::min<uint64_t>(block.size(), header.count - read));
+                benchmark::DoNotOptimize(block.data());
+            }
+        }
+    }
+
+    state.SetBytesProcessed(state.iterations() * state.range(0) * sizeof(int64_t));
+}
+BENCHMARK(BM_DecodePayload)->ArgsProduct({ { 1 << 22 }, { 0, 1 } });
+
+// The delta-varint payload decoded with two copies per pair (0) and with one
+// SSSE3 shuffle (1).
+static void BM_DecodeDeltaVarint(benchmark::State& state) {
+    PairDecoding decoding = static_cast<PairDecoding>(state.range(1));
+    makeIdQueue(state.range(0)).serializeBinary("binary_data_queue.bin", BinaryEncoding::DeltaVarint);
+    std::vector<int64_t> block(4096);
+
+    if (DeltaVarintDecoder<int64_t>(decoding).pairDecoding() != decoding) {
+        state.SkipWithError("SSSE3 is not available");
+        return;
+    }
+
+    for (auto _ : state) {
+        BinaryReader reader("binary_data_queue.bin");
+        BinaryHeader header;
+        reader.read(&header, sizeof(header));
+
+        DeltaVarintDecoder<int64_t> decoder(decoding);
+        decoder.read(reader, header.count);
+
+        while (decoder.next(block.data(), block.size()) > 0) {
+            benchmark::DoNotOptimize(block.data());
+        }
+    }
+
+    state.SetBytesProcessed(state.iterations() * state.range(0) * sizeof(int64_t));
+}
+BENCHMARK(BM_DecodeDeltaVarint)->ArgsProduct({ { 1 << 22 }, { 0, 1 } });
+
+// Fork-join fib(30) with fine-grained tasks (serial below fib(state.range(0)))
+// on the work-stealing pool and on the central mutex Queue.
+static void BM_ForkJoinFibWorkStealing(benchmark::State& state) {
+    ThreadPool pool;
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(parallelFib(pool, 30, state.range(0)));
+    }
+}
+BENCHMARK(BM_ForkJoinFibWorkStealing)->Arg(8)->Arg(16)->UseRealTime();
+
+static void BM_ForkJoinFibCentralQueue(benchmark::State& state) {
+    CentralQueuePool pool;
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(parallelFib(pool, 30, state.range(0)));
+    }
+}
+BENCHMARK(BM_ForkJoinFibCentralQueue)->Arg(8)->Arg(16)->UseRealTime();
+
+BENCHMARK_MAIN();
\ No newline at end of file
@@ -0,0 +1,361 @@
+#include <benchmark/benchmark.h>
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <array>
+#include <atomic>
+#include <iterator>
+#include <thread>
+#include <vector>
+#include "stack.h"
+
+static void BM_Push(benchmark::State& state) {
+    Stack<int> myStack;
+
+    for (auto _ : state) {
+        myStack.push(42);
+    }
+}
+BENCHMARK(BM_Push);
+
+// Push a batch of state.range(0) elements and pop it again, node-based versus
+// inline storage.
+static void BM_PushPopBatch(benchmark::State& state) {
+    Stack<int> myStack;
+
+    for (auto _ : state) {
+        for (int i = 0; i < state.range(0); ++i) {
+            myStack.push(i);
+        }
+
+        for (int i = 0; i < state.range(0); ++i) {
+            myStack.pop();
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_PushPopBatch)->Arg(1)->Arg(16)->Arg(256)->Arg(4096);
+
+// The same batches through pushRange and popInto.
+static void BM_PushRangePopIntoBatch(benchmark::State& state) {
+    Stack<int> myStack;
+    std::vector<int> batch(state.range(0));
+
+    for (int i = 0; i < state.range(0); ++i) {
+        batch[i] = i;
+    }
+
+    for (auto _ : state) {
+        myStack.pushRange(batch.data(), batch.size());
+        myStack.popInto(batch.data(), batch.size());
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_PushRangePopIntoBatch)->Arg(1)->Arg(16)->Arg(256)->Arg(4096);
+
+static void BM_PushRangeDrainBatch(benchmark::State& state) {
+    Stack<int> myStack;
+    std::vector<int> batch(state.range(0), 42);
+    int64_t sum = 0;
+
+    for (auto _ : state) {
+        myStack.pushRange(batch.data(), batch.size());
+        myStack.drain([&sum](int value) { sum += value; });
+    }
+
+    benchmark::DoNotOptimize(sum);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_PushRangeDrainBatch)->Arg(1)->Arg(16)->Arg(256)->Arg(4096);
+
+static void BM_StaticPushPopBatch(benchmark::State& state) {
+    static StaticStack<int, 4096> myStack;
+
+    for (auto _ : state) {
+        for (int i = 0; i < state.range(0); ++i) {
+            myStack.push(i);
+        }
+
+        for (int i = 0; i < state.range(0); ++i) {
+            myStack.pop();
+        }
+
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_StaticPushPopBatch)->Arg(1)->Arg(16)->Arg(256)->Arg(4096);
+
+static void BM_StaticPushRangePopIntoBatch(benchmark::State& state) {
+    static StaticStack<int, 4096> myStack;
+    std::vector<int> batch(state.range(0), 42);
+
+    for (auto _ : state) {
+        myStack.pushRange(batch.data(), batch.size());
+        myStack.popInto(batch.data(), batch.size());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_StaticPushRangePopIntoBatch)->Arg(1)->Arg(16)->Arg(256)->Arg(4096);
+
+// Taking a snapshot of a stack with state.range(0) elements: the persistent
+// stack shares its nodes, the baseline copies them out.
+static void BM_PersistentSnapshot(benchmark::State& state) {
+    PersistentStack<int> myStack;
+
+    for (int i = 0; i < state.range(0); ++i) {
+        myStack.push(i);
+    }
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(myStack.snapshot());
+    }
+}
+BENCHMARK(BM_PersistentSnapshot)->Arg(1 << 10)->Arg(1 << 20);
+
+static void BM_CopySnapshot(benchmark::State& state) {
+    PersistentStack<int> myStack;
+
+    for (int i = 0; i < state.range(0); ++i) {
+        myStack.push(i);
+    }
+
+    for (auto _ : state) {
+        PersistentStack<int>::Snapshot snapshot = myStack.snapshot();
+        std::vector<int> copy(snapshot.begin(), snapshot.end());
+        benchmark::DoNotOptimize(copy.data());
+    }
+}
+BENCHMARK(BM_CopySnapshot)->Arg(1 << 10)->Arg(1 << 20);
+
+// Thread 0 keeps pushing and popping while the other threads take snapshots and
+// sum them; items are the elements the readers visit.
+static void BM_PersistentReadersUnderWrites(benchmark::State& state) {
+    static PersistentStack<int>* myStack = nullptr;
+
+    if (state.thread_index() == 0) {
+        myStack = new PersistentStack<int>();
+
+        for (int i = 0; i < 1 << 16; ++i) {
+            myStack->push(i);
+        }
+    }
+
+    int64_t visited = 0;
+
+    for (auto _ : state) {
+        if (state.thread_index() == 0) {
+            myStack->push(42);
+            myStack->pop();
+            continue;
+        }
+
+        int64_t sum = 0;
+
+        for (int value : myStack->snapshot()) {
+            sum += value;
+            ++visited;
+        }
+
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetItemsProcessed(visited);
+
+    if (state.thread_index() == 0) {
+        delete myStack;
+    }
+}
+BENCHMARK(BM_PersistentReadersUnderWrites)->Threads(2)->Threads(4)->UseRealTime();
+
+static void BM_SerializeBinary(benchmark::State& state) {
+    Stack<int> myStack;
+
+    for (int i = 0; i < state.range(0); ++i) {
+        myStack.push(i);
+    }
+
+    for (auto _ : state) {
+        myStack.serializeBinary("binary_data.bin");
+    }
+
+    state.SetBytesProcessed(state.iterations() * state.range(0) * sizeof(int));
+}
+BENCHMARK(BM_SerializeBinary)->Range(1 << 10, 1 << 22);
+
+static void BM_DeserializeBinary(benchmark::State& state) {
+    Stack<int> myStack;
+
+    for (int i = 0; i < state.range(0); ++i) {
+        myStack.push(i);
+    }
+
+    myStack.serializeBinary("binary_data.bin");
+
+    for (auto _ : state) {
+        Stack<int> newStack;
+        newStack.deserializeBinary("binary_data.bin");
+        benchmark::DoNotOptimize(newStack);
+    }
+
+    state.SetBytesProcessed(state.iterations() * state.range(0) * sizeof(int));
+}
+BENCHMARK(BM_DeserializeBinary)->Range(1 << 10, 1 << 22);
+
+// Time the calling thread is blocked, synchronous versus asynchronous; the
+// asynchronous write is awaited outside the timed region.
+static void BM_SerializeBinaryPause(benchmark::State& state) {
+    Stack<int> myStack;
+
+    for (int i = 0; i < state.range(0); ++i) {
+        myStack.push(i);
+    }
+
+    for (auto _ : state) {
+        myStack.serializeBinary("binary_data.bin");
+    }
+
+    state.SetBytesProcessed(state.iterations() * state.range(0) * sizeof(int));
+}
+BENCHMARK(BM_SerializeBinaryPause)->Range(1 << 12, 1 << 22)->UseRealTime();
+
+static void BM_SerializeBinaryAsyncPause(benchmark::State& state) {
+    Stack<int> myStack;
+
+    for (int i = 0; i < state.range(0); ++i) {
+        myStack.push(i);
+    }
+
+    AsyncWriter writer(size_t(state.range(0)) * sizeof(int) + AsyncWriter::BUFFER_SIZE, 2);
+
+    for (auto _ : state) {
+        std::future<bool> done = myStack.serializeBinaryAsync("binary_data_async.bin", writer);
+
+        state.PauseTiming();
+        done.wait();
+        state.ResumeTiming();
+    }
+
+    state.SetBytesProcessed(state.iterations() * state.range(0) * sizeof(int));
+}
+BENCHMARK(BM_SerializeBinaryAsyncPause)->Range(1 << 12, 1 << 22)->UseRealTime();
+
+// Cross-language workloads: the same operations and sizes as the criterion
+// groups in rust/stack_bench.rs, named BM_Cross<Group>/<size>, for
+// bench/compareStack.py to put side by side.
+static Stack<int>* filledStack(int64_t size) {
+    Stack<int>* myStack = new Stack<int>();
+
+    for (int64_t i = 0; i < size; ++i) {
+        myStack->push(static_cast<int>(i));
+    }
+
+    return myStack;
+}
+
+static void BM_CrossPush(benchmark::State& state) {
+    for (auto _ : state) {
+        std::unique_ptr<Stack<int>> myStack(filledStack(state.range(0)));
+        benchmark::DoNotOptimize(myStack.get());
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_CrossPush)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+
+static void BM_CrossSerializeText(benchmark::State& state) {
+    std::unique_ptr<Stack<int>> myStack(filledStack(state.range(0)));
+
+    for (auto _ : state) {
+        std::string text = myStack->serializeText();
+        benchmark::DoNotOptimize(text.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_CrossSerializeText)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+
+static void BM_CrossDeserializeText(benchmark::State& state) {
+    std::string text = std::unique_ptr<Stack<int>>(filledStack(state.range(0)))->serializeText();
+
+    for (auto _ : state) {
+        Stack<int> myStack;
+        myStack.deserializeText(text);
+        benchmark::DoNotOptimize(myStack);
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_CrossDeserializeText)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+
+static void BM_CrossSerializeBinary(benchmark::State& state) {
+    std::unique_ptr<Stack<int>> myStack(filledStack(state.range(0)));
+
+    for (auto _ : state) {
+        myStack->serializeBinary("binary_data.bin");
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_CrossSerializeBinary)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+
+static void BM_CrossDeserializeBinary(benchmark::State& state) {
+    std::unique_ptr<Stack<int>>(filledStack(state.range(0)))->serializeBinary("binary_data.bin");
+
+    for (auto _ : state) {
+        Stack<int> myStack;
+        myStack.deserializeBinary("binary_data.bin");
+        benchmark::DoNotOptimize(myStack);
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_CrossDeserializeBinary)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+
+// Raw throughput of the buffered layer on a 1 GB dump, written in blocks of
+// state.range(0) bytes so the dump never has to fit in memory at once.
+static const size_t DUMP_SIZE = size_t(1) << 30;
+
+static void BM_BinaryWriterDump(benchmark::State& state) {
+    std::vector<char> block(state.range(0), 'x');
+
+    for (auto _ : state) {
+        BinaryWriter writer("binary_dump.bin");
+        writer.writeHeader(1, DUMP_SIZE);
+
+        for (size_t written = 0; written < DUMP_SIZE; written += block.size()) {
+            writer.write(block.data(), block.size());
+        }
+
+        writer.close();
+    }
+
+    state.SetBytesProcessed(state.iterations() * DUMP_SIZE);
+}
+BENCHMARK(BM_BinaryWriterDump)->Arg(64)->Arg(1 << 24)->Unit(benchmark::kMillisecond);
+
+static void BM_BinaryReaderDump(benchmark::State& state) {
+    std::vector<char> block(state.range(0));
+
+    for (auto _ : state) {
+        BinaryReader reader("binary_dump.bin");
+        BinaryHeader header;
+        reader.readHeader(header, 1);
+
+        for (size_t read = 0; read < header.count && reader.read(block.data(), block.size()); read += block.size()) {
+            benchmark::DoNotOptimize(block.data());
+        }
+    }
+
+    state.SetBytesProcessed(state.iterations() * DUMP_SIZE);
+}
+BENCHMARK(BM_BinaryReaderDump)->Arg(64)->Arg(1 << 24)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
\ No newline at end of file
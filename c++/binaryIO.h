@@ -0,0 +1,414 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+enum class BinaryEncoding : uint8_t {
+    Raw = 0,
+    DeltaVarint = 1,
+    PerfectHash = 2
+};
+
+// Every binary dump starts with this header so readers can validate the file
+// and know the element count before reading the payload.
+struct BinaryHeader {
+    static constexpr uint32_t MAGIC = 0x42414C33; // "3LAB"
+    static constexpr uint16_t VERSION = 1;
+    static constexpr uint8_t LITTLE_ENDIAN_TAG = 1;
+    static constexpr uint8_t BIG_ENDIAN_TAG = 2;
+
+    uint32_t magic;
+    uint16_t version;
+    uint8_t endianness;
+    BinaryEncoding encoding;
+    uint32_t elementSize;
+    uint32_t padding;
+    uint64_t count;
+
+    BinaryHeader() : BinaryHeader(0, 0) {}
+
+    BinaryHeader(uint32_t elementSize, uint64_t count, BinaryEncoding encoding = BinaryEncoding::Raw)
+        : magic(MAGIC), version(VERSION), endianness(nativeEndianness()), encoding(encoding),
+          elementSize(elementSize), padding(0), count(count) {}
+
+    static uint8_t nativeEndianness() {
+        const uint16_t probe = 1;
+        return *reinterpret_cast<const uint8_t*>(&probe) == 1 ? LITTLE_ENDIAN_TAG : BIG_ENDIAN_TAG;
+    }
+
+    bool isValid(uint32_t expectedElementSize) const {
+        return magic == MAGIC && version == VERSION && endianness == nativeEndianness()
+            && elementSize == expectedElementSize;
+    }
+};
+
+static_assert(sizeof(BinaryHeader) == 24, "BinaryHeader must have a fixed on-disk layout");
+
+// Value encoding shared by every binary destination. Trivially copyable values
+// are written as their bytes and strings with a length prefix; Derived only has
+// to provide write(data, size).
+template <typename Derived>
+class BinarySink {
+public:
+    void writeHeader(uint32_t elementSize, uint64_t count, BinaryEncoding encoding = BinaryEncoding::Raw) {
+        BinaryHeader header(elementSize, count, encoding);
+        self().write(&header, sizeof(header));
+    }
+
+    template <typename T>
+    void writeValue(const T& value) {
+        if constexpr (std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view>) {
+            uint64_t length = value.size();
+            self().write(&length, sizeof(length));
+            self().write(value.data(), value.size());
+        }
+        else {
+            static_assert(std::is_trivially_copyable_v<T>, "binary serialization requires a trivially copyable type");
+            self().write(&value, sizeof(T));
+        }
+    }
+
+    template <typename T>
+    void writeArray(const T* values, size_t count) {
+        static_assert(std::is_trivially_copyable_v<T>, "binary serialization requires a trivially copyable type");
+        self().write(values, count * sizeof(T));
+    }
+
+private:
+    Derived& self() {
+        return static_cast<Derived&>(*this);
+    }
+};
+
+// The reading side of BinarySink; Derived provides read(data, size) and, for
+// strings, readString(value, length).
+template <typename Derived>
+class BinarySource {
+public:
+    template <typename T>
+    bool readValue(T& value) {
+        if constexpr (std::is_same_v<T, std::string>) {
+            uint64_t length = 0;
+            return self().read(&length, sizeof(length)) && self().readString(value, length);
+        }
+        else {
+            static_assert(std::is_trivially_copyable_v<T>, "binary serialization requires a trivially copyable type");
+            return self().read(&value, sizeof(T));
+        }
+    }
+
+    template <typename T>
+    bool readArray(T* values, size_t count) {
+        static_assert(std::is_trivially_copyable_v<T>, "binary serialization requires a trivially copyable type");
+        return self().read(values, count * sizeof(T));
+    }
+
+private:
+    Derived& self() {
+        return static_cast<Derived&>(*this);
+    }
+};
+
+// Buffered writer on top of write(2). Small writes are gathered in a user-space
+// buffer; writes larger than the buffer bypass it.
+class BinaryWriter : public BinarySink<BinaryWriter> {
+public:
+    static constexpr size_t BUFFER_SIZE = 1 << 20;
+
+    explicit BinaryWriter(const std::string& filename)
+        : fd(::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)), used(0), written(0), failed(false) {
+        buffer.resize(BUFFER_SIZE);
+    }
+
+    BinaryWriter(const BinaryWriter&) = delete;
+    BinaryWriter& operator=(const BinaryWriter&) = delete;
+
+    ~BinaryWriter() {
+        close();
+    }
+
+    bool is_open() const {
+        return fd >= 0;
+    }
+
+    bool good() const {
+        return is_open() && !failed;
+    }
+
+    uint64_t bytesWritten() const {
+        return written + used;
+    }
+
+    // Rewrites the count of a header written at the start of the file, for
+    // containers that only know their size after walking every node.
+    void patchCount(uint64_t count) {
+        flush();
+
+        if (is_open() && ::pwrite(fd, &count, sizeof(count), offsetof(BinaryHeader, count)) != sizeof(count)) {
+            failed = true;
+        }
+    }
+
+    void write(const void* data, size_t size) {
+        if (used + size > buffer.size()) {
+            flush();
+
+            if (size >= buffer.size()) {
+                writeAll(static_cast<const char*>(data), size);
+                return;
+            }
+        }
+
+        std::memcpy(buffer.data() + used, data, size);
+        used += size;
+    }
+
+    void flush() {
+        if (used > 0) {
+            writeAll(buffer.data(), used);
+            used = 0;
+        }
+    }
+
+    void close() {
+        if (is_open()) {
+            flush();
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
+private:
+    int fd;
+    std::vector<char> buffer;
+    size_t used;
+    uint64_t written;
+    bool failed;
+
+    void writeAll(const char* data, size_t size) {
+        while (size > 0 && is_open()) {
+            ssize_t result = ::write(fd, data, size);
+
+            if (result <= 0) {
+                failed = true;
+                return;
+            }
+
+            data += result;
+            size -= result;
+            written += result;
+        }
+    }
+};
+
+// Buffered reader on top of read(2), the counterpart of BinaryWriter.
+class BinaryReader : public BinarySource<BinaryReader> {
+public:
+    static constexpr size_t BUFFER_SIZE = 1 << 20;
+
+    explicit BinaryReader(const std::string& filename)
+        : fd(::open(filename.c_str(), O_RDONLY)), position(0), available(0), eof(false) {
+        buffer.resize(BUFFER_SIZE);
+    }
+
+    BinaryReader(const BinaryReader&) = delete;
+    BinaryReader& operator=(const BinaryReader&) = delete;
+
+    ~BinaryReader() {
+        close();
+    }
+
+    bool is_open() const {
+        return fd >= 0;
+    }
+
+    bool readHeader(BinaryHeader& header, uint32_t expectedElementSize,
+                    BinaryEncoding expectedEncoding = BinaryEncoding::Raw) {
+        return read(&header, sizeof(header)) && header.isValid(expectedElementSize)
+            && header.encoding == expectedEncoding;
+    }
+
+    bool read(void* data, size_t size) {
+        char* out = static_cast<char*>(data);
+        size_t buffered = available - position;
+
+        if (size <= buffered) {
+            std::memcpy(out, buffer.data() + position, size);
+            position += size;
+            return true;
+        }
+
+        std::memcpy(out, buffer.data() + position, buffered);
+        out += buffered;
+        size -= buffered;
+        position = available = 0;
+
+        if (size >= buffer.size()) {
+            return readAll(out, size) == size;
+        }
+
+        available = readAll(buffer.data(), buffer.size());
+
+        if (available < size) {
+            std::memcpy(out, buffer.data(), available);
+            position = available;
+            return false;
+        }
+
+        std::memcpy(out, buffer.data(), size);
+        position = size;
+        return true;
+    }
+
+    // The length comes from the file, so the string grows only as its bytes
+    // arrive, a buffer at a time: a corrupt length fails at the end of the file
+    // instead of allocating the size it claims.
+    bool readString(std::string& value, uint64_t length) {
+        value.clear();
+
+        while (length > 0) {
+            size_t chunk = std::min<uint64_t>(length, BUFFER_SIZE);
+            size_t offset = value.size();
+            value.resize(offset + chunk);
+
+            if (!read(value.data() + offset, chunk)) {
+                return false;
+            }
+
+            length -= chunk;
+        }
+
+        return true;
+    }
+
+    void close() {
+        if (is_open()) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
+private:
+    int fd;
+    std::vector<char> buffer;
+    size_t position;
+    size_t available;
+    bool eof;
+
+    size_t readAll(char* data, size_t size) {
+        size_t total = 0;
+
+        while (total < size && !eof && is_open()) {
+            ssize_t result = ::read(fd, data + total, size - total);
+
+            if (result <= 0) {
+                eof = true;
+                break;
+            }
+
+            total += result;
+        }
+
+        return total;
+    }
+};
+
+// Whole-range positional I/O, for writers and readers that split a file into
+// segments handled by different threads.
+inline bool pwriteAll(int fd, const void* data, size_t size, uint64_t offset) {
+    const char* bytes = static_cast<const char*>(data);
+
+    while (size > 0) {
+        ssize_t result = ::pwrite(fd, bytes, size, offset);
+
+        if (result <= 0) {
+            return false;
+        }
+
+        bytes += result;
+        size -= result;
+        offset += result;
+    }
+
+    return true;
+}
+
+inline bool preadAll(int fd, void* data, size_t size, uint64_t offset) {
+    char* bytes = static_cast<char*>(data);
+
+    while (size > 0) {
+        ssize_t result = ::pread(fd, bytes, size, offset);
+
+        if (result <= 0) {
+            return false;
+        }
+
+        bytes += result;
+        size -= result;
+        offset += result;
+    }
+
+    return true;
+}
+
+// In-memory counterparts of BinaryWriter and BinaryReader, using the same
+// encoding for values.
+class BufferWriter : public BinarySink<BufferWriter> {
+public:
+    void write(const void* data, size_t size) {
+        const char* begin = static_cast<const char*>(data);
+        bytes.insert(bytes.end(), begin, begin + size);
+    }
+
+    const char* data() const {
+        return bytes.data();
+    }
+
+    size_t size() const {
+        return bytes.size();
+    }
+
+    void clear() {
+        bytes.clear();
+    }
+
+private:
+    std::vector<char> bytes;
+};
+
+class BufferReader : public BinarySource<BufferReader> {
+public:
+    BufferReader(const char* data, size_t size) : cursor(data), end(data + size) {}
+
+    bool read(void* data, size_t size) {
+        if (static_cast<size_t>(end - cursor) < size) {
+            return false;
+        }
+
+        std::memcpy(data, cursor, size);
+        cursor += size;
+        return true;
+    }
+
+    bool readString(std::string& value, uint64_t length) {
+        if (static_cast<size_t>(end - cursor) < length) {
+            return false;
+        }
+
+        value.assign(cursor, length);
+        cursor += length;
+        return true;
+    }
+
+private:
+    const char* cursor;
+    const char* end;
+};
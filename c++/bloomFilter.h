@@ -0,0 +1,87 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Split-block Bloom filter: every key sets one bit in each of the eight 32-bit
+// words of a single 32-byte block, so a query touches one cache line and needs
+// no loop-carried branches. At BITS_PER_KEY bits per expected key about 1% of
+// absent keys pass. Keys are given as well-mixed 64-bit hashes (see mixHash):
+// the upper half picks the block, the lower half the bits.
+class BlockedBloomFilter {
+public:
+    static constexpr size_t BITS_PER_KEY = 10;
+
+    struct alignas(32) Block {
+        uint32_t words[8];
+    };
+
+    explicit BlockedBloomFilter(size_t expectedKeys = 0)
+        : blocks(std::max<size_t>(1, (expectedKeys * BITS_PER_KEY + 255) / 256), Block{}) {}
+
+    void insert(uint64_t hash) {
+        Block& block = blocks[blockOf(hash)];
+        uint32_t key = static_cast<uint32_t>(hash);
+
+        for (size_t word = 0; word < 8; ++word) {
+            block.words[word] |= bitOf(key, word);
+        }
+    }
+
+    // False means the key was never inserted; true means it probably was.
+    bool mayContain(uint64_t hash) const {
+        const Block& block = blocks[blockOf(hash)];
+        uint32_t key = static_cast<uint32_t>(hash);
+        uint32_t missing = 0;
+
+        for (size_t word = 0; word < 8; ++word) {
+            missing |= bitOf(key, word) & ~block.words[word];
+        }
+
+        return missing == 0;
+    }
+
+    size_t bytes() const {
+        return blocks.size() * sizeof(Block);
+    }
+
+    // The block count followed by the blocks.
+    template <typename Sink>
+    void write(Sink& sink) const {
+        sink.writeValue(static_cast<uint64_t>(blocks.size()));
+        sink.writeArray(blocks.data(), blocks.size());
+    }
+
+    // Reads a filter written by write() that takes up exactly length bytes.
+    template <typename Source>
+    bool read(Source& source, size_t length) {
+        uint64_t count = 0;
+
+        if (length < sizeof(count) || !source.readValue(count) || count == 0
+            || count != (length - sizeof(count)) / sizeof(Block) || length != serializedBytes(count)) {
+            return false;
+        }
+
+        blocks.assign(count, Block{});
+        return source.readArray(blocks.data(), blocks.size());
+    }
+
+    static size_t serializedBytes(uint64_t blockCount) {
+        return sizeof(uint64_t) + blockCount * sizeof(Block);
+    }
+
+private:
+    std::vector<Block> blocks;
+
+    size_t blockOf(uint64_t hash) const {
+        return static_cast<size_t>(((hash >> 32) * blocks.size()) >> 32);
+    }
+
+    static uint32_t bitOf(uint32_t key, size_t word) {
+        static constexpr uint32_t SALTS[8] = {0x47B6137BU, 0x44974D91U, 0x8824AD5BU, 0xA2B7289DU,
+                                              0x705495C7U, 0x2DF1424BU, 0x9EFC4947U, 0x5C6BFB31U};
+        return uint32_t(1) << ((key * SALTS[word]) >> 27);
+    }
+};
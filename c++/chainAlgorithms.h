@@ -0,0 +1,178 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include "workStealing.h"
+
+// Algorithms on chains of nodes linked through a next pointer and ended by
+// nullptr. They relink the existing nodes instead of copying elements, so none
+// of them allocates; callers that keep prev pointers or a tail fix them up
+// afterwards.
+
+// Chains at least this long are sorted in parallel by parallelSortChain.
+const size_t PARALLEL_SORT_THRESHOLD = 1 << 16;
+
+// Merges two sorted chains. On ties the node from first comes first.
+template <typename NodeT, typename Less>
+NodeT* mergeChains(NodeT* first, NodeT* second, const Less& less) {
+    NodeT* head = nullptr;
+    NodeT** link = &head;
+
+    while (first != nullptr && second != nullptr) {
+        if (less(second->data, first->data)) {
+            *link = second;
+            second = second->next;
+        }
+        else {
+            *link = first;
+            first = first->next;
+        }
+
+        link = &(*link)->next;
+    }
+
+    *link = first != nullptr ? first : second;
+    return head;
+}
+
+// Stable bottom-up merge sort. bins[i] holds a sorted run of 2^i nodes taken
+// from earlier in the chain than anything in the lower bins, so each node is
+// carried up like a binary counter and no pass has to walk the chain to split it.
+template <typename NodeT, typename Less>
+NodeT* sortChain(NodeT* head, const Less& less) {
+    std::array<NodeT*, 64> bins{};
+
+    while (head != nullptr) {
+        NodeT* run = head;
+        head = head->next;
+        run->next = nullptr;
+
+        size_t level = 0;
+
+        while (bins[level] != nullptr) {
+            run = mergeChains(bins[level], run, less);
+            bins[level] = nullptr;
+            ++level;
+        }
+
+        bins[level] = run;
+    }
+
+    NodeT* sorted = nullptr;
+
+    for (NodeT* run : bins) {
+        if (run != nullptr) {
+            sorted = mergeChains(run, sorted, less);
+        }
+    }
+
+    return sorted;
+}
+
+// Cuts the chain into one piece per worker, sorts the pieces as pool tasks and
+// merges them pairwise, each round of merges running in parallel. Short chains
+// and single-threaded pools fall back to sortChain.
+template <typename NodeT, typename Less>
+NodeT* parallelSortChain(NodeT* head, size_t length, const Less& less, ThreadPool& pool) {
+    if (length < PARALLEL_SORT_THRESHOLD || pool.size() < 2) {
+        return sortChain(head, less);
+    }
+
+    std::array<NodeT*, 64> pieces{};
+    size_t count = std::min<size_t>(pool.size(), pieces.size());
+    size_t pieceLength = (length + count - 1) / count;
+
+    for (size_t piece = 0; piece < count && head != nullptr; ++piece) {
+        pieces[piece] = head;
+
+        for (size_t step = 1; step < pieceLength && head->next != nullptr; ++step) {
+            head = head->next;
+        }
+
+        NodeT* next = head->next;
+        head->next = nullptr;
+        head = next;
+    }
+
+    {
+        ThreadPool::TaskGroup group(pool);
+
+        for (size_t piece = 0; piece < count; ++piece) {
+            group.run([&pieces, &less, piece]() { pieces[piece] = sortChain(pieces[piece], less); });
+        }
+
+        group.wait();
+    }
+
+    for (size_t width = 1; width < count; width *= 2) {
+        ThreadPool::TaskGroup group(pool);
+
+        for (size_t piece = 0; piece + width < count; piece += width * 2) {
+            group.run([&pieces, &less, piece, width]() {
+                pieces[piece] = mergeChains(pieces[piece], pieces[piece + width], less);
+                pieces[piece + width] = nullptr;
+            });
+        }
+
+        group.wait();
+    }
+
+    return pieces[0];
+}
+
+template <typename NodeT>
+NodeT* reverseChain(NodeT* head) {
+    NodeT* reversed = nullptr;
+
+    while (head != nullptr) {
+        NodeT* next = head->next;
+        head->next = reversed;
+        reversed = head;
+        head = next;
+    }
+
+    return reversed;
+}
+
+// Deletes every node equal to the node before it and returns how many were
+// deleted.
+template <typename NodeT>
+size_t uniqueChain(NodeT* head) {
+    size_t removed = 0;
+
+    while (head != nullptr && head->next != nullptr) {
+        NodeT* next = head->next;
+
+        if (next->data == head->data) {
+            head->next = next->next;
+            delete next;
+            ++removed;
+        }
+        else {
+            head = next;
+        }
+    }
+
+    return removed;
+}
+
+template <typename NodeT>
+size_t chainLength(const NodeT* head) {
+    size_t length = 0;
+
+    for (; head != nullptr; head = head->next) {
+        ++length;
+    }
+
+    return length;
+}
+
+template <typename NodeT>
+NodeT* chainTail(NodeT* head) {
+    while (head != nullptr && head->next != nullptr) {
+        head = head->next;
+    }
+
+    return head;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <atomic>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// Messages about empty containers and missing keys go to this hook instead of
+// straight to std::cerr. No hook is installed by default, so those paths do no
+// formatting and no I/O unless a caller opts in, e.g. with
+// setDiagnosticHook(logToStderr).
+using DiagnosticHook = void (*)(const std::string& message);
+
+inline std::atomic<DiagnosticHook>& diagnosticHook() {
+    static std::atomic<DiagnosticHook> hook(nullptr);
+    return hook;
+}
+
+inline void setDiagnosticHook(DiagnosticHook hook) {
+    diagnosticHook().store(hook, std::memory_order_relaxed);
+}
+
+inline void logToStderr(const std::string& message) {
+    std::cerr << message << std::endl;
+}
+
+template <typename... Parts>
+void diagnose(const Parts&... parts) {
+    DiagnosticHook hook = diagnosticHook().load(std::memory_order_relaxed);
+
+    if (hook == nullptr) {
+        return;
+    }
+
+    std::ostringstream oss;
+    (oss << ... << parts);
+    hook(oss.str());
+}
@@ -1,110 +1,13 @@
-#include <benchmark/benchmark.h>
 #include <gtest/gtest.h>
 #include <iostream>
 #include <sstream>
 #include <fstream>
-
-template <typename T>
-struct Node {
-    T data;
-    Node* prev;
-    Node* next;
-
-    Node(const T& value) : data(value), prev(nullptr), next(nullptr) {}
-};
-
-template <typename T>
-class DoublyList {
-private:
-    Node<T>* head;
-
-public:
-    DoublyList() : head(nullptr) {}
-
-    void append(const T& value) {
-        Node<T>* newNode = new Node<T>(value);
-
-        if (head == nullptr) {
-            head = newNode;
-        }
-        else {
-            Node<T>* current = head;
-            while (current->next != nullptr) {
-                current = current->next;
-            }
-            current->next = newNode;
-            newNode->prev = current;
-        }
-    }
-
-    std::string serializeText() const {
-        std::ostringstream oss;
-        Node<T>* current = head;
-
-        while (current != nullptr) {
-            oss << current->data << " ";
-            current = current->next;
-        }
-
-        return oss.str();
-    }
-
-    void deserializeText(const std::string& data) {
-
-        std::istringstream iss(data);
-        T value;
-
-        while (iss >> value) {
-            append(value);
-        }
-    }
-
-    void serializeBinary(const std::string& filename) const {
-        std::ofstream ofs(filename, std::ios::binary);
-
-        if (ofs.is_open()) {
-            Node<T>* current = head;
-
-            while (current != nullptr) {
-                ofs.write(reinterpret_cast<char*>(&current->data), sizeof(T));
-                current = current->next;
-            }
-
-            ofs.close();
-        }
-        else {
-            std::cerr << "Unable to open the file for binary serialization." << std::endl;
-        }
-    }
-
-    void deserializeBinary(const std::string& filename) {
-
-        std::ifstream ifs(filename, std::ios::binary);
-
-        if (ifs.is_open()) {
-            T value;
-
-            while (ifs.read(reinterpret_cast<char*>(&value), sizeof(T))) {
-                append(value);
-            }
-
-            ifs.close();
-        }
-        else {
-            std::cerr << "Unable to open the file for binary deserialization." << std::endl;
-        }
-    }
-
-    void display() const {
-        Node<T>* current = head;
-        while (current != nullptr) {
-            std::cout << current->data << " ";
-            current = current->next;
-        }
-        std::cout << std::endl;
-    }
-};
-
+#include <functional>
+#include <random>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "doublyList.h"
 
 TEST(DoublyListTest, SerializeAndDeserializeText) {
     DoublyList<int> myList;
@@ -144,77 +47,58 @@ TEST(DoublyListTest, SerializeAndDeserializeBinary) {
     EXPECT_EQ(output, "1 2 3 \n");
 }
 
-static void BM_Append(benchmark::State& state) {
-    DoublyList<int> myList;
-
-    for (auto _ : state) {
-        myList.append(42);
-    }
-}
-BENCHMARK(BM_Append);
-
-static void BM_SerializeText(benchmark::State& state) {
-    DoublyList<int> myList;
+TEST(DoublyListTest, SerializeTextToFileDescriptor) {
+    DoublyList<double> myList;
 
-    myList.append(1);
-    myList.append(2);
-    myList.append(3);
+    myList.append(1.5);
+    myList.append(-2.25);
+    myList.append(3e10);
 
-    for (auto _ : state) {
-        std::string serializedData = myList.serializeText();
-        benchmark::DoNotOptimize(serializedData);
-    }
-}
-BENCHMARK(BM_SerializeText);
+    int fd = ::open("text_data.txt", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ASSERT_TRUE(myList.serializeText(fd));
+    ::close(fd);
 
-static void BM_DeserializeText(benchmark::State& state) {
-    DoublyList<int> myList;
+    std::ifstream ifs("text_data.txt");
+    std::string text((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
 
-    myList.append(1);
-    myList.append(2);
-    myList.append(3);
+    EXPECT_EQ(text, myList.serializeText());
 
-    std::string serializedData = myList.serializeText();
+    DoublyList<double> newList;
+    newList.deserializeText(text);
 
-    for (auto _ : state) {
-        DoublyList<int> newList;
-        newList.deserializeText(serializedData);
-        benchmark::DoNotOptimize(newList);
-    }
+    EXPECT_EQ(newList.serializeText(), "1.5 -2.25 3e+10 ");
 }
-BENCHMARK(BM_DeserializeText);
 
-static void BM_SerializeBinary(benchmark::State& state) {
+TEST(DoublyListTest, SortUniqueMergeReverse) {
     DoublyList<int> myList;
+    ThreadPool pool(4);
+    std::mt19937 random(9);
 
-    myList.append(1);
-    myList.append(2);
-    myList.append(3);
-
-    for (auto _ : state) {
-        myList.serializeBinary("binary_data.bin");
+    for (int i = 0; i < 100000; ++i) {
+        myList.append(random() % 50000);
     }
-}
-BENCHMARK(BM_SerializeBinary);
 
-static void BM_DeserializeBinary(benchmark::State& state) {
-    DoublyList<int> myList;
+    myList.sort(std::less<int>(), pool);
+    myList.unique();
 
-    myList.append(1);
-    myList.append(2);
-    myList.append(3);
+    DoublyList<int> other;
+    other.append(-2);
+    other.append(60000);
+    myList.merge(other);
 
-    myList.serializeBinary("binary_data.bin");
+    // reverse walks prev pointers, so this also checks that they were relinked.
+    myList.reverse();
+    myList.append(-3);
 
-    for (auto _ : state) {
-        DoublyList<int> newList;
-        newList.deserializeBinary("binary_data.bin");
-        benchmark::DoNotOptimize(newList);
-    }
-}
-BENCHMARK(BM_DeserializeBinary);
+    std::vector<int> values;
+    myList.visit([&](int value) { values.push_back(value); });
 
-BENCHMARK_MAIN();
+    ASSERT_GE(values.size(), 3u);
+    EXPECT_EQ(values.front(), 60000);
+    EXPECT_EQ(values[values.size() - 2], -2);
+    EXPECT_EQ(values.back(), -3);
+    EXPECT_TRUE(std::adjacent_find(values.begin(), values.end(), std::less_equal<int>()) == values.end());
+}
 
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
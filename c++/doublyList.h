@@ -0,0 +1,247 @@
+#pragma once
+
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "binaryIO.h"
+#include "asyncWriter.h"
+#include "textIO.h"
+#include "chainAlgorithms.h"
+#include "instrumentation.h"
+
+template <typename T>
+struct DoublyNode {
+    T data;
+    DoublyNode* prev;
+    DoublyNode* next;
+
+    DoublyNode(const T& value) : data(value), prev(nullptr), next(nullptr) {}
+};
+
+template <typename T>
+class DoublyList {
+private:
+    DoublyNode<T>* head;
+    DoublyNode<T>* tail;
+
+    // The chain algorithms only maintain next; this restores prev and tail.
+    void relink() {
+        DoublyNode<T>* previous = nullptr;
+
+        for (DoublyNode<T>* current = head; current != nullptr; current = current->next) {
+            current->prev = previous;
+            previous = current;
+        }
+
+        tail = previous;
+    }
+
+public:
+    // Allocation and operation counts of every list of this type, all zero
+    // unless built with CONTAINER_INSTRUMENTATION; see instrumentation.h.
+    using Counters = CountersFor<DoublyList>;
+
+    static CounterSnapshot counters() {
+        return Counters::snapshot();
+    }
+
+    DoublyList() : head(nullptr), tail(nullptr) {}
+
+    DoublyList(const DoublyList&) = delete;
+    DoublyList& operator=(const DoublyList&) = delete;
+
+    ~DoublyList() {
+        clear();
+    }
+
+    void clear() {
+        while (head != nullptr) {
+            DoublyNode<T>* next = head->next;
+            delete head;
+            Counters::released(sizeof(DoublyNode<T>));
+            head = next;
+        }
+
+        tail = nullptr;
+    }
+
+    void append(const T& value) {
+        DoublyNode<T>* newNode = new DoublyNode<T>(value);
+        Counters::allocated(sizeof(DoublyNode<T>));
+        Counters::operation();
+
+        if (head == nullptr) {
+            head = tail = newNode;
+        }
+        else {
+            tail->next = newNode;
+            newNode->prev = tail;
+            tail = newNode;
+        }
+    }
+
+    // Stable merge sort that relinks the nodes; lists of PARALLEL_SORT_THRESHOLD
+    // elements or more are sorted on pool.
+    template <typename Less = std::less<T>>
+    void sort(const Less& less = Less(), ThreadPool& pool = ThreadPool::shared()) {
+        head = parallelSortChain(head, chainLength(head), less, pool);
+        relink();
+    }
+
+    // Removes every element equal to the one before it and returns how many
+    // were removed.
+    size_t unique() {
+        size_t removed = uniqueChain(head);
+        Counters::released(removed * sizeof(DoublyNode<T>), removed);
+        Counters::operation(removed);
+        relink();
+        return removed;
+    }
+
+    // Moves the nodes of other, which must be sorted like this list, into
+    // their sorted places here; other is left empty.
+    template <typename Less = std::less<T>>
+    void merge(DoublyList<T>& other, const Less& less = Less()) {
+        if (other.head == nullptr) {
+            return;
+        }
+
+        head = mergeChains(head, other.head, less);
+        other.head = other.tail = nullptr;
+        relink();
+    }
+
+    void reverse() {
+        for (DoublyNode<T>* current = head; current != nullptr; current = current->prev) {
+            std::swap(current->prev, current->next);
+        }
+
+        std::swap(head, tail);
+    }
+
+    template <typename Visitor>
+    void visit(Visitor&& visitor) const {
+        for (DoublyNode<T>* current = head; current != nullptr; current = current->next) {
+            visitor(current->data);
+        }
+    }
+
+    std::string serializeText() const {
+        std::string text;
+        DoublyNode<T>* current = head;
+
+        while (current != nullptr) {
+            appendText(text, current->data);
+            text += ' ';
+            current = current->next;
+        }
+
+        Counters::serialized(text.size());
+        return text;
+    }
+
+    bool serializeText(int fd) const {
+        TextWriter writer(fd);
+        DoublyNode<T>* current = head;
+
+        while (current != nullptr) {
+            writer.write(current->data);
+            writer.write(" ");
+            current = current->next;
+        }
+
+        writer.flush();
+        Counters::serialized(writer.bytesWritten());
+        return writer.good();
+    }
+
+    void deserializeText(const std::string& data) {
+
+        TextReader reader(data);
+        T value;
+
+        while (reader.read(value)) {
+            append(value);
+        }
+    }
+
+    void serializeBinary(const std::string& filename) const {
+        BinaryWriter writer(filename);
+
+        if (writer.is_open()) {
+            writer.writeHeader(sizeof(T), 0);
+            DoublyNode<T>* current = head;
+            uint64_t count = 0;
+
+            while (current != nullptr) {
+                writer.writeValue(current->data);
+                current = current->next;
+                ++count;
+            }
+
+            writer.patchCount(count);
+            Counters::serialized(writer.bytesWritten());
+            writer.close();
+        }
+        else {
+            std::cerr << "Unable to open the file for binary serialization." << std::endl;
+        }
+    }
+
+    // Encodes the dump into the writer's buffers and returns once the last byte
+    // is queued; the future reports when the file is complete.
+    std::future<bool> serializeBinaryAsync(const std::string& filename, AsyncWriter& writer = AsyncWriter::shared()) const {
+        AsyncWriter::Snapshot snapshot = writer.begin(filename);
+        snapshot.writeHeader(sizeof(T), 0);
+        DoublyNode<T>* current = head;
+        uint64_t count = 0;
+
+        while (current != nullptr) {
+            snapshot.writeValue(current->data);
+            current = current->next;
+            ++count;
+        }
+
+        snapshot.patchCount(count);
+        return snapshot.finish();
+    }
+
+    void deserializeBinary(const std::string& filename) {
+
+        BinaryReader reader(filename);
+
+        if (reader.is_open()) {
+            BinaryHeader header;
+
+            if (!reader.readHeader(header, sizeof(T))) {
+                std::cerr << "Invalid binary header." << std::endl;
+                return;
+            }
+
+            T value;
+
+            for (uint64_t i = 0; i < header.count && reader.readValue(value); ++i) {
+                append(value);
+            }
+
+            reader.close();
+        }
+        else {
+            std::cerr << "Unable to open the file for binary deserialization." << std::endl;
+        }
+    }
+
+    void display() const {
+        DoublyNode<T>* current = head;
+        while (current != nullptr) {
+            std::cout << current->data << " ";
+            current = current->next;
+        }
+        std::cout << std::endl;
+    }
+};
@@ -0,0 +1,519 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "binaryIO.h"
+#include "diagnostics.h"
+#include "hashMix.h"
+#include "instrumentation.h"
+
+// Read-only table indexed by a minimal perfect hash, built like PTHash: keys
+// are split into buckets of about LAMBDA keys and every bucket stores the pilot
+// that sends all of its keys to free positions of a table about 1% larger than
+// the key count. The few keys that land past the end are remapped into the
+// holes left below it, so the entries fill their array without gaps. A lookup
+// is a pilot read and exactly one slot read, for hits and misses alike.
+//
+// The table is one image with the same layout in memory and on disk, so save()
+// writes it as it is and the filename constructor maps it without parsing:
+//   BinaryHeader       encoding PerfectHash, count = number of entries
+//   seed, buckets, positions
+//   pilots             uint32_t per bucket, padded to 8 bytes
+//   remap              uint64_t per position past the entries
+//   entries            (key, value) pairs, in hash order
+template <typename Key, typename Value>
+class FrozenHashTable {
+    static_assert(std::is_trivially_copyable_v<Key> && std::is_trivially_copyable_v<Value>,
+                  "frozen tables are mapped from disk and need trivially copyable keys and values");
+
+public:
+    struct Entry {
+        Key key;
+        Value value;
+    };
+
+    static_assert(alignof(Entry) <= 8, "entries would be misaligned in the image");
+
+    static constexpr uint64_t LAMBDA = 5;
+    static constexpr int MAX_ATTEMPTS = 8;
+    static constexpr uint64_t MAX_PILOT = uint64_t(1) << 24;
+
+    // Lookup counts of every frozen table of this type, all zero unless built
+    // with CONTAINER_INSTRUMENTATION; see instrumentation.h.
+    using Counters = CountersFor<FrozenHashTable>;
+
+    static CounterSnapshot counters() {
+        return Counters::snapshot();
+    }
+
+    FrozenHashTable() : mapping(nullptr), length(0) {
+        detach();
+    }
+
+    // Builds the table from distinct keys. Leaves it empty when two keys have
+    // equal std::hash values, which no perfect hash can tell apart, or in the
+    // unlikely case that no seed tried lets every bucket find a pilot.
+    explicit FrozenHashTable(const std::vector<std::pair<Key, Value>>& input) : FrozenHashTable() {
+        build(input);
+    }
+
+    // Maps a file written by save().
+    explicit FrozenHashTable(const std::string& filename) : FrozenHashTable() {
+        int fd = ::open(filename.c_str(), O_RDONLY);
+
+        if (fd < 0) {
+            std::cerr << "Unable to open the file for mapping." << std::endl;
+            return;
+        }
+
+        struct stat info;
+
+        if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+            length = info.st_size;
+            mapping = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+
+            if (mapping == MAP_FAILED) {
+                mapping = nullptr;
+                length = 0;
+            }
+        }
+
+        ::close(fd);
+
+        if (mapping == nullptr || !attach(static_cast<const char*>(mapping), length)) {
+            std::cerr << "Invalid binary header." << std::endl;
+            unmap();
+            return;
+        }
+
+        ::madvise(mapping, length, MADV_RANDOM);
+    }
+
+    FrozenHashTable(const FrozenHashTable&) = delete;
+    FrozenHashTable& operator=(const FrozenHashTable&) = delete;
+
+    FrozenHashTable(FrozenHashTable&& other) noexcept : mapping(nullptr), length(0) {
+        *this = std::move(other);
+    }
+
+    FrozenHashTable& operator=(FrozenHashTable&& other) noexcept {
+        if (this != &other) {
+            release();
+            owned = std::move(other.owned);
+            mapping = other.mapping;
+            length = other.length;
+            image = other.image;
+            seed = other.seed;
+            bucketCount = other.bucketCount;
+            positions = other.positions;
+            count = other.count;
+            pilots = other.pilots;
+            remap = other.remap;
+            entries = other.entries;
+
+            other.owned.clear();
+            other.mapping = nullptr;
+            other.length = 0;
+            other.detach();
+        }
+
+        return *this;
+    }
+
+    ~FrozenHashTable() {
+        release();
+    }
+
+    bool is_open() const {
+        return image != nullptr;
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    bool isEmpty() const {
+        return count == 0;
+    }
+
+    // Size of the image, in memory and on disk.
+    size_t bytes() const {
+        return image == nullptr ? 0 : imageBytes(count, bucketCount, positions);
+    }
+
+    bool contains(const Key& key) const {
+        const Entry* entry = slotFor(key);
+        return entry != nullptr && entry->key == key;
+    }
+
+    // The value stored under key, or std::nullopt on a miss, without any
+    // diagnostic output.
+    std::optional<Value> find(const Key& key) const {
+        const Entry* entry = slotFor(key);
+
+        if (entry == nullptr || !(entry->key == key)) {
+            return std::nullopt;
+        }
+
+        return entry->value;
+    }
+
+    Value get(const Key& key) const {
+        const Entry* entry = slotFor(key);
+
+        if (entry == nullptr || !(entry->key == key)) {
+            diagnose("An element with a key ", key, " not found.");
+            return Value();
+        }
+
+        return entry->value;
+    }
+
+    // Entries in slot order, which is neither key nor insertion order.
+    const Entry* begin() const {
+        return entries;
+    }
+
+    const Entry* end() const {
+        return entries + count;
+    }
+
+    void save(const std::string& filename) const {
+        BinaryWriter writer(filename);
+
+        if (writer.is_open() && image != nullptr) {
+            writer.write(image, imageBytes(count, bucketCount, positions));
+            writer.close();
+        }
+        else {
+            std::cerr << "Unable to open the file for binary serialization." << std::endl;
+        }
+    }
+
+private:
+    static constexpr size_t SHAPE_BYTES = sizeof(BinaryHeader) + 3 * sizeof(uint64_t);
+
+    enum class Placement {
+        Placed,
+        EqualHashes,
+        PilotsExhausted
+    };
+
+    std::vector<uint64_t> owned;
+    void* mapping;
+    size_t length;
+
+    const char* image;
+    uint64_t seed;
+    uint64_t bucketCount;
+    uint64_t positions;
+    size_t count;
+    const uint32_t* pilots;
+    const uint64_t* remap;
+    const Entry* entries;
+
+    static uint64_t hashOf(const Key& key, uint64_t seed) {
+        return mixHash(std::hash<Key>{}(key) ^ seed);
+    }
+
+    static uint64_t bucketOf(uint64_t hash, uint64_t buckets) {
+        return static_cast<uint64_t>((static_cast<unsigned __int128>(hash) * buckets) >> 64);
+    }
+
+    static uint64_t positionOf(uint64_t hash, uint64_t pilot, uint64_t positions) {
+        uint64_t mixed = mixHash(hash ^ (pilot * 0x9E3779B97F4A7C15ULL));
+        return static_cast<uint64_t>((static_cast<unsigned __int128>(mixed) * positions) >> 64);
+    }
+
+    static size_t pilotBytes(uint64_t buckets) {
+        return (buckets * sizeof(uint32_t) + 7) & ~size_t(7);
+    }
+
+    static size_t imageBytes(uint64_t entryCount, uint64_t buckets, uint64_t positionCount) {
+        return SHAPE_BYTES + pilotBytes(buckets) + (positionCount - entryCount) * sizeof(uint64_t)
+            + ((entryCount * sizeof(Entry) + 7) & ~size_t(7));
+    }
+
+    const Entry* slotFor(const Key& key) const {
+        Counters::operation();
+
+        if (count == 0) {
+            return nullptr;
+        }
+
+        uint64_t hash = hashOf(key, seed);
+        uint64_t position = positionOf(hash, pilots[bucketOf(hash, bucketCount)], positions);
+
+        if (position >= count) {
+            position = remap[position - count];
+        }
+
+        Counters::lookup(1);
+        return entries + position;
+    }
+
+    void build(const std::vector<std::pair<Key, Value>>& input) {
+        size_t entryCount = input.size();
+        uint64_t buckets = std::max<uint64_t>(1, (entryCount + LAMBDA - 1) / LAMBDA);
+        uint64_t positionCount = entryCount + entryCount / 100;
+        std::vector<uint64_t> hashes(entryCount);
+        std::vector<uint32_t> pilotValues(buckets);
+        std::vector<uint64_t> slots(entryCount);
+        Placement placement = Placement::PilotsExhausted;
+        uint64_t trySeed = 0;
+
+        for (int attempt = 0; attempt < MAX_ATTEMPTS && placement == Placement::PilotsExhausted; ++attempt) {
+            trySeed = mixHash(attempt + 1);
+
+            for (size_t i = 0; i < entryCount; ++i) {
+                hashes[i] = hashOf(input[i].first, trySeed);
+            }
+
+            placement = placeBuckets(hashes, buckets, positionCount, pilotValues, slots);
+        }
+
+        if (placement == Placement::EqualHashes) {
+            std::cerr << "Unable to build a perfect hash: two keys have equal hashes." << std::endl;
+            return;
+        }
+
+        if (placement == Placement::PilotsExhausted) {
+            std::cerr << "Unable to build a perfect hash: no pilot fits some bucket with any of the " << MAX_ATTEMPTS
+                      << " seeds tried." << std::endl;
+            return;
+        }
+
+        owned.assign(imageBytes(entryCount, buckets, positionCount) / sizeof(uint64_t), 0);
+        char* out = reinterpret_cast<char*>(owned.data());
+
+        BinaryHeader header(sizeof(Entry), entryCount, BinaryEncoding::PerfectHash);
+        uint64_t shape[3] = {trySeed, buckets, positionCount};
+        std::memcpy(out, &header, sizeof(header));
+        std::memcpy(out + sizeof(header), shape, sizeof(shape));
+        std::memcpy(out + SHAPE_BYTES, pilotValues.data(), buckets * sizeof(uint32_t));
+
+        uint64_t* remapOut = reinterpret_cast<uint64_t*>(out + SHAPE_BYTES + pilotBytes(buckets));
+        Entry* entryOut = reinterpret_cast<Entry*>(remapOut + (positionCount - entryCount));
+        fillHoles(slots, positionCount, remapOut);
+
+        for (size_t i = 0; i < entryCount; ++i) {
+            std::memcpy(&entryOut[slots[i]].key, &input[i].first, sizeof(Key));
+            std::memcpy(&entryOut[slots[i]].value, &input[i].second, sizeof(Value));
+        }
+
+        attach(out, owned.size() * sizeof(uint64_t));
+        Counters::allocated(owned.size() * sizeof(uint64_t), entryCount);
+    }
+
+    // Gives every used position past the entries one of the holes below them,
+    // in order, and moves its key there. There are exactly as many holes as
+    // such positions.
+    static void fillHoles(std::vector<uint64_t>& slots, uint64_t positionCount, uint64_t* remapOut) {
+        size_t entryCount = slots.size();
+        std::vector<bool> used(positionCount, false);
+
+        for (uint64_t slot : slots) {
+            used[slot] = true;
+        }
+
+        uint64_t hole = 0;
+
+        for (uint64_t position = entryCount; position < positionCount; ++position) {
+            if (used[position]) {
+                while (used[hole]) {
+                    ++hole;
+                }
+
+                remapOut[position - entryCount] = hole++;
+            }
+        }
+
+        for (uint64_t& slot : slots) {
+            if (slot >= entryCount) {
+                slot = remapOut[slot - entryCount];
+            }
+        }
+    }
+
+    // Places the buckets largest first, while the table is still empty, which
+    // keeps the pilots small. slots[i] receives the position of key i.
+    static Placement placeBuckets(const std::vector<uint64_t>& hashes, uint64_t buckets, uint64_t positionCount,
+                                  std::vector<uint32_t>& pilotValues, std::vector<uint64_t>& slots) {
+        std::vector<uint64_t> bucketStart(buckets + 1, 0);
+
+        for (uint64_t hash : hashes) {
+            ++bucketStart[bucketOf(hash, buckets) + 1];
+        }
+
+        uint64_t largest = 0;
+
+        for (uint64_t bucket = 0; bucket < buckets; ++bucket) {
+            largest = std::max(largest, bucketStart[bucket + 1]);
+            bucketStart[bucket + 1] += bucketStart[bucket];
+        }
+
+        std::vector<uint64_t> members(hashes.size());
+        std::vector<uint64_t> next(bucketStart.begin(), bucketStart.end() - 1);
+
+        for (size_t i = 0; i < hashes.size(); ++i) {
+            members[next[bucketOf(hashes[i], buckets)]++] = i;
+        }
+
+        // Counting sort of the buckets by size, largest first.
+        std::vector<uint64_t> sizeStart(largest + 2, 0);
+
+        for (uint64_t bucket = 0; bucket < buckets; ++bucket) {
+            ++sizeStart[largest - (bucketStart[bucket + 1] - bucketStart[bucket]) + 1];
+        }
+
+        for (uint64_t size = 0; size <= largest; ++size) {
+            sizeStart[size + 1] += sizeStart[size];
+        }
+
+        std::vector<uint64_t> order(buckets);
+
+        for (uint64_t bucket = 0; bucket < buckets; ++bucket) {
+            order[sizeStart[largest - (bucketStart[bucket + 1] - bucketStart[bucket])]++] = bucket;
+        }
+
+        std::vector<bool> taken(positionCount, false);
+        std::vector<uint64_t> candidate;
+        std::vector<uint64_t> sorted;
+        std::fill(pilotValues.begin(), pilotValues.end(), 0);
+
+        for (uint64_t bucket : order) {
+            const uint64_t* first = members.data() + bucketStart[bucket];
+            size_t size = bucketStart[bucket + 1] - bucketStart[bucket];
+
+            if (size == 0) {
+                break;
+            }
+
+            sorted.clear();
+
+            for (size_t k = 0; k < size; ++k) {
+                sorted.push_back(hashes[first[k]]);
+            }
+
+            std::sort(sorted.begin(), sorted.end());
+
+            if (std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end()) {
+                return Placement::EqualHashes;
+            }
+
+            candidate.resize(size);
+            uint64_t pilot = 0;
+
+            for (; pilot < MAX_PILOT; ++pilot) {
+                bool free = true;
+
+                for (size_t k = 0; k < size && free; ++k) {
+                    candidate[k] = positionOf(hashes[first[k]], pilot, positionCount);
+                    free = !taken[candidate[k]];
+
+                    for (size_t earlier = 0; earlier < k && free; ++earlier) {
+                        free = candidate[earlier] != candidate[k];
+                    }
+                }
+
+                if (free) {
+                    break;
+                }
+            }
+
+            if (pilot == MAX_PILOT) {
+                return Placement::PilotsExhausted;
+            }
+
+            for (size_t k = 0; k < size; ++k) {
+                taken[candidate[k]] = true;
+                slots[first[k]] = candidate[k];
+            }
+
+            pilotValues[bucket] = static_cast<uint32_t>(pilot);
+        }
+
+        return Placement::Placed;
+    }
+
+    // Points the views into an image, after checking that its sizes agree and
+    // that every remapped position lands on an entry. An empty table never
+    // reads its remap table, so older empty images with a zero entry there
+    // still attach.
+    bool attach(const char* data, size_t bytes) {
+        if (bytes < SHAPE_BYTES) {
+            return false;
+        }
+
+        const BinaryHeader* header = reinterpret_cast<const BinaryHeader*>(data);
+        const uint64_t* shape = reinterpret_cast<const uint64_t*>(data + sizeof(BinaryHeader));
+
+        if (!header->isValid(sizeof(Entry)) || header->encoding != BinaryEncoding::PerfectHash || shape[1] == 0
+            || shape[1] > bytes / sizeof(uint32_t) || shape[2] < header->count || header->count > bytes / sizeof(Entry)
+            || shape[2] - header->count > bytes / sizeof(uint64_t)
+            || imageBytes(header->count, shape[1], shape[2]) != bytes) {
+            return false;
+        }
+
+        const uint64_t* remapped = reinterpret_cast<const uint64_t*>(data + SHAPE_BYTES + pilotBytes(shape[1]));
+
+        for (uint64_t i = 0; header->count > 0 && i < shape[2] - header->count; ++i) {
+            if (remapped[i] >= header->count) {
+                return false;
+            }
+        }
+
+        image = data;
+        seed = shape[0];
+        bucketCount = shape[1];
+        positions = shape[2];
+        count = header->count;
+        pilots = reinterpret_cast<const uint32_t*>(data + SHAPE_BYTES);
+        remap = reinterpret_cast<const uint64_t*>(data + SHAPE_BYTES + pilotBytes(bucketCount));
+        entries = reinterpret_cast<const Entry*>(remap + (positions - count));
+        return true;
+    }
+
+    void detach() {
+        image = nullptr;
+        seed = 0;
+        bucketCount = 0;
+        positions = 0;
+        count = 0;
+        pilots = nullptr;
+        remap = nullptr;
+        entries = nullptr;
+    }
+
+    void unmap() {
+        if (mapping) {
+            ::munmap(mapping, length);
+        }
+
+        mapping = nullptr;
+        length = 0;
+        detach();
+    }
+
+    void release() {
+        if (!owned.empty()) {
+            Counters::released(owned.size() * sizeof(uint64_t), count);
+            owned.clear();
+            owned.shrink_to_fit();
+        }
+
+        unmap();
+    }
+};
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+
+// Finalizer of MurmurHash3: every output bit depends on every input bit. Used
+// to spread hashes that may be weak, such as std::hash of an integer, which is
+// the integer itself.
+inline uint64_t mixHash(uint64_t hash) {
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
@@ -1,195 +1,384 @@
-#include <benchmark/benchmark.h>
 #include <gtest/gtest.h>
 #include <iostream>
 #include <vector>
 #include <sstream>
 #include <fstream>
+#include <algorithm>
+#include <thread>
+#include <optional>
+#include <cstring>
+#include <cstddef>
+#include <iterator>
+#include <fcntl.h>
+#include <unistd.h>
+#include "hashTable.h"
 
+TEST(HashTableTest, InsertAndRetrieve) {
+    HashTable<std::string, int> myHashTable;
+
+    myHashTable.insert("one", 1);
+    myHashTable.insert("two", 2);
+
+    EXPECT_EQ(myHashTable.get("one"), 1);
+    EXPECT_EQ(myHashTable.get("two"), 2);
+}
+
+TEST(HashTableTest, Remove) {
+    HashTable<std::string, int> myHashTable;
+
+    myHashTable.insert("one", 1);
+    myHashTable.insert("two", 2);
+
+    myHashTable.remove("one");
+
+    EXPECT_EQ(myHashTable.get("one"), 0);
+    EXPECT_EQ(myHashTable.get("two"), 2);
+}
+
+TEST(HashTableTest, GetNonExistentKey) {
+    HashTable<std::string, int> myHashTable;
 
-template <typename Key, typename Value>
-class HashTable {
-private:
-    static const size_t TABLE_SIZE = 10;
+    EXPECT_EQ(myHashTable.get("nonexistent"), 0);
+}
+
+TEST(HashTableTest, SerializeAndDeserializeBinary) {
+    HashTable<std::string, int> myHashTable;
 
-    struct HashNode {
-        Key key;
-        Value value;
-        bool occupied;
+    myHashTable.insert("one", 1);
+    myHashTable.insert("a key longer than the small string buffer", 2);
+
+    myHashTable.serializeBinary("binary_file.bin");
 
-        HashNode() : occupied(false) {}
-    };
+    HashTable<std::string, int> newHashTable;
+    newHashTable.deserializeBinary("binary_file.bin");
 
-    std::vector<HashNode> table;
+    EXPECT_EQ(newHashTable.get("one"), 1);
+    EXPECT_EQ(newHashTable.get("a key longer than the small string buffer"), 2);
+}
 
-    size_t hashFunction(const Key& key) const {
-        return std::hash<Key>{}(key) % TABLE_SIZE;
+TEST(HashTableTest, GrowAndParallelSerializeBinary) {
+    HashTable<int, int> myHashTable;
+
+    for (int key = 0; key < 10000; ++key) {
+        myHashTable.insert(key, key * 2);
     }
 
-public:
-    HashTable() : table(TABLE_SIZE) {}
+    myHashTable.serializeBinary("binary_file.bin", 4);
 
-    void insert(const Key& key, const Value& value) {
-        size_t index = hashFunction(key);
+    HashTable<int, int> newHashTable;
+    newHashTable.insert(-1, -1);
+    newHashTable.deserializeBinary("binary_file.bin", 3);
 
-        while (table[index].occupied && table[index].key != key) {
-            index = (index + 1) % TABLE_SIZE;
-        }
+    EXPECT_EQ(newHashTable.size(), 10001u);
+
+    for (int key = 0; key < 10000; ++key) {
+        ASSERT_EQ(newHashTable.get(key), key * 2);
+    }
 
-        table[index].key = key;
-        table[index].value = value;
-        table[index].occupied = true;
+    EXPECT_EQ(newHashTable.get(-1), -1);
+}
+
+TEST(HashTableTest, RejectCorruptDirectory) {
+    HashTable<int, int> myHashTable;
+
+    for (int key = 0; key < 1000; ++key) {
+        myHashTable.insert(key, key);
     }
 
-    void remove(const Key& key) {
-        size_t index = hashFunction(key);
+    myHashTable.serializeBinary("binary_file.bin", 4);
 
-        while (table[index].occupied) {
-            if (table[index].key == key) {
-                table[index].occupied = false;
-                return;
-            }
+    std::vector<char> image;
+    {
+        std::ifstream in("binary_file.bin", std::ios::binary);
+        image.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
 
-            index = (index + 1) % TABLE_SIZE;
+    // Segment count, the first segment's size, and the header's entry count.
+    size_t segmentCountOffset = sizeof(BinaryHeader);
+    size_t firstSizeOffset = sizeof(BinaryHeader) + 2 * sizeof(uint64_t);
+    size_t countOffset = offsetof(BinaryHeader, count);
+
+    for (size_t offset : { segmentCountOffset, firstSizeOffset, countOffset }) {
+        std::vector<char> corrupt(image);
+        uint64_t huge = uint64_t(1) << 60;
+        std::memcpy(corrupt.data() + offset, &huge, sizeof(huge));
+        {
+            std::ofstream out("binary_file_corrupt.bin", std::ios::binary);
+            out.write(corrupt.data(), corrupt.size());
         }
 
-        std::cerr << "An element with a key " << key << " not found." << std::endl;
+        HashTable<int, int> newHashTable;
+        newHashTable.insert(-1, -1);
+        newHashTable.deserializeBinary("binary_file_corrupt.bin", 2);
+
+        EXPECT_EQ(newHashTable.size(), 1u);
     }
+}
+
+TEST(HashTableTest, SerializeBinaryAsync) {
+    HashTable<std::string, int> myHashTable;
 
-    Value get(const Key& key) const {
-        size_t index = hashFunction(key);
+    myHashTable.insert("one", 1);
+    myHashTable.insert("two", 2);
 
-        while (table[index].occupied) {
-            if (table[index].key == key) {
-                return table[index].value;
-            }
+    ASSERT_TRUE(myHashTable.serializeBinaryAsync("binary_file_async.bin").get());
 
-            index = (index + 1) % TABLE_SIZE;
-        }
+    HashTable<std::string, int> newHashTable;
+    newHashTable.deserializeBinary("binary_file_async.bin");
 
-        std::cerr << "An element with a key " << key << " not found." << std::endl;
-        return Value();
+    EXPECT_EQ(newHashTable.size(), 2u);
+    EXPECT_EQ(newHashTable.get("two"), 2);
+}
+
+TEST(HashTableTest, FindAndTryRemove) {
+    HashTable<std::string, int> myHashTable;
+
+    myHashTable.insert("zero", 0);
+
+    EXPECT_EQ(myHashTable.find("zero"), std::optional<int>(0));
+    EXPECT_EQ(myHashTable.find("missing"), std::nullopt);
+    EXPECT_TRUE(myHashTable.tryRemove("zero"));
+    EXPECT_FALSE(myHashTable.tryRemove("zero"));
+    EXPECT_EQ(myHashTable.find("zero"), std::nullopt);
+}
+
+TEST(HashTableTest, FilterRejectsMisses) {
+    using Table = HashTable<int, int>;
+    Table myHashTable;
+    myHashTable.enableFilter();
+
+    for (int i = 0; i < 10000; ++i) {
+        myHashTable.insert(i, i);
     }
 
-    std::string serializeText() const {
-        std::ostringstream oss;
+    for (int i = 0; i < 10000; i += 2) {
+        myHashTable.remove(i);
+    }
 
-        for (const auto& node : table) {
-            if (node.occupied) {
-                oss << node.key << ":" << node.value << " ";
-            }
-        }
+    for (int i = 0; i < 10000; ++i) {
+        EXPECT_EQ(myHashTable.find(i), i % 2 == 1 ? std::optional<int>(i) : std::nullopt);
+    }
+
+    CounterSnapshot before = Table::counters();
 
-        return oss.str();
+    for (int i = 10000; i < 20000; ++i) {
+        EXPECT_EQ(myHashTable.find(i), std::nullopt);
     }
 
-    void deserializeText(const std::string& data) {
+    CounterSnapshot misses = Table::counters() - before;
 
-        std::istringstream iss(data);
-        std::string keyValue;
+    // About 1% of the misses get past the filter, each probing a few slots.
+    EXPECT_EQ(misses[Counter::Lookups], 10000);
+    EXPECT_LT(misses[Counter::Probes], 1000);
+}
 
-        while (iss >> keyValue) {
-            size_t delimiterPos = keyValue.find(':');
-            if (delimiterPos != std::string::npos) {
-                Key key = keyValue.substr(0, delimiterPos);
-                Value value = std::stoi(keyValue.substr(delimiterPos + 1));
-                insert(key, value);
-            }
-        }
+TEST(HashTableTest, FilterIsSerialized) {
+    HashTable<int, int> myHashTable;
+    myHashTable.enableFilter();
+
+    for (int i = 0; i < 1000; ++i) {
+        myHashTable.insert(i, -i);
     }
 
-    void serializeBinary(const std::string& filename) const {
-        std::ofstream ofs(filename, std::ios::binary);
+    myHashTable.serializeBinary("binary_filter.bin", 4);
 
-        if (ofs.is_open()) {
-            for (const auto& node : table) {
-                if (node.occupied) {
-                    ofs.write(reinterpret_cast<const char*>(&node.key), sizeof(Key));
-                    ofs.write(reinterpret_cast<const char*>(&node.value), sizeof(Value));
-                }
-            }
+    HashTable<int, int> newHashTable;
+    newHashTable.deserializeBinary("binary_filter.bin", 4);
 
-            ofs.close();
-        }
-        else {
-            std::cerr << "Unable to open the file for binary serialization." << std::endl;
-        }
+    EXPECT_TRUE(newHashTable.hasFilter());
+    EXPECT_EQ(newHashTable.size(), 1000u);
+
+    for (int i = 0; i < 1000; ++i) {
+        EXPECT_EQ(newHashTable.find(i), std::optional<int>(-i));
     }
 
-    void deserializeBinary(const std::string& filename) {
+    EXPECT_EQ(newHashTable.find(1000), std::nullopt);
+
+    std::future<bool> done = myHashTable.serializeBinaryAsync("binary_filter_async.bin");
+    ASSERT_TRUE(done.get());
 
-        std::ifstream ifs(filename, std::ios::binary);
+    HashTable<int, int> asyncHashTable;
+    asyncHashTable.insert(-1, 1);
+    asyncHashTable.deserializeBinary("binary_filter_async.bin");
 
-        if (ifs.is_open()) {
-            while (ifs) {
-                Key key;
-                Value value;
+    EXPECT_TRUE(asyncHashTable.hasFilter());
+    EXPECT_EQ(asyncHashTable.size(), 1001u);
+    EXPECT_EQ(asyncHashTable.find(-1), std::optional<int>(1));
+    EXPECT_EQ(asyncHashTable.find(999), std::optional<int>(-999));
+
+    myHashTable.disableFilter();
+    myHashTable.serializeBinary("binary_filter.bin");
+
+    HashTable<int, int> plainHashTable;
+    plainHashTable.deserializeBinary("binary_filter.bin");
+
+    EXPECT_FALSE(plainHashTable.hasFilter());
+    EXPECT_EQ(plainHashTable.find(999), std::optional<int>(-999));
+}
 
-                ifs.read(reinterpret_cast<char*>(&key), sizeof(Key));
-                ifs.read(reinterpret_cast<char*>(&value), sizeof(Value));
+// The tests are built with CONTAINER_INSTRUMENTATION, and HashTable<long, long>
+// is used by this test only.
+TEST(HashTableTest, ProbeCounters) {
+    using Table = HashTable<long, long>;
 
-                if (ifs) {
-                    insert(key, value);
-                }
-            }
+    {
+        Table myHashTable;
 
-            ifs.close();
+        for (long i = 0; i < 100; ++i) {
+            myHashTable.insert(i, i);
         }
-        else {
-            std::cerr << "Unable to open the file for binary deserialization." << std::endl;
+
+        CounterSnapshot before = Table::counters();
+
+        for (long i = 0; i < 100; ++i) {
+            EXPECT_EQ(myHashTable.find(i), std::optional<long>(i));
         }
-    }
 
-};
+        EXPECT_EQ(myHashTable.find(1000), std::nullopt);
 
-TEST(HashTableTest, InsertAndRetrieve) {
-    HashTable<std::string, int> myHashTable;
+        CounterSnapshot lookups = Table::counters() - before;
 
-    myHashTable.insert("one", 1);
-    myHashTable.insert("two", 2);
+        EXPECT_EQ(lookups[Counter::Lookups], 101);
+        EXPECT_EQ(lookups[Counter::Operations], 101);
+        EXPECT_GE(lookups.probesPerLookup(), 1.0);
+        EXPECT_EQ(lookups[Counter::Allocations], 0);
+        EXPECT_GE(Table::counters()[Counter::LiveNodes], 100 * 100 / 70);
+    }
 
-    EXPECT_EQ(myHashTable.get("one"), 1);
-    EXPECT_EQ(myHashTable.get("two"), 2);
+    EXPECT_EQ(Table::counters()[Counter::LiveNodes], 0);
+    EXPECT_EQ(Table::counters()[Counter::LiveBytes], 0);
 }
 
-TEST(HashTableTest, Remove) {
+TEST(HashTableTest, StringKeys) {
     HashTable<std::string, int> myHashTable;
+    std::vector<std::string> keys;
 
-    myHashTable.insert("one", 1);
-    myHashTable.insert("two", 2);
+    for (int i = 0; i < 2000; ++i) {
+        keys.push_back(i % 2 ? "k" + std::to_string(i) : "a-long-key-kept-in-the-arena-" + std::to_string(i));
+        myHashTable.insert(keys.back(), i);
+    }
 
-    myHashTable.remove("one");
+    myHashTable.insert("", -1);
+    myHashTable.insert(std::string(15, 'x'), -15);
+    myHashTable.insert(std::string(16, 'x'), -16);
 
-    EXPECT_EQ(myHashTable.get("one"), 0);
-    EXPECT_EQ(myHashTable.get("two"), 2);
-}
+    for (int i = 0; i < 2000; ++i) {
+        EXPECT_EQ(myHashTable.find(keys[i]), std::optional<int>(i));
+    }
 
-TEST(HashTableTest, GetNonExistentKey) {
-    HashTable<std::string, int> myHashTable;
+    EXPECT_EQ(myHashTable.find(""), std::optional<int>(-1));
+    EXPECT_EQ(myHashTable.find(std::string(15, 'x')), std::optional<int>(-15));
+    EXPECT_EQ(myHashTable.find(std::string(16, 'x')), std::optional<int>(-16));
+    EXPECT_EQ(myHashTable.find(std::string(17, 'x')), std::nullopt);
+    EXPECT_EQ(myHashTable.find("a-long-key-kept-in-the-arena-1"), std::nullopt);
 
-    EXPECT_EQ(myHashTable.get("nonexistent"), 0);
-}
+    // Removing most long keys compacts the arena under the remaining ones.
+    for (int i = 0; i < 1800; i += 2) {
+        EXPECT_TRUE(myHashTable.tryRemove(keys[i]));
+    }
 
-static void BM_Insert(benchmark::State& state) {
-    HashTable<std::string, int> myHashTable;
+    myHashTable.insert(keys[1], 1000);
 
-    for (auto _ : state) {
-        myHashTable.insert("key", 42); 
+    for (int i = 0; i < 2000; ++i) {
+        EXPECT_EQ(myHashTable.find(keys[i]), i < 1800 && i % 2 == 0 ? std::nullopt : std::optional<int>(i == 1 ? 1000 : i));
     }
+
+    myHashTable.serializeBinary("binary_strings.bin", 4);
+
+    HashTable<std::string, int> newHashTable;
+    newHashTable.insert(keys[1998], 0);
+    newHashTable.deserializeBinary("binary_strings.bin", 4);
+
+    EXPECT_EQ(newHashTable.size(), myHashTable.size());
+    EXPECT_EQ(newHashTable.find(keys[1998]), std::optional<int>(1998));
+    EXPECT_EQ(newHashTable.find(keys[1999]), std::optional<int>(1999));
+    EXPECT_EQ(newHashTable.find(std::string(16, 'x')), std::optional<int>(-16));
+    EXPECT_EQ(newHashTable.find(keys[0]), std::nullopt);
+    EXPECT_EQ(newHashTable.serializeText().size(), myHashTable.serializeText().size());
 }
-BENCHMARK(BM_Insert);
 
-static void BM_Get(benchmark::State& state) {
-    HashTable<std::string, int> myHashTable;
-    myHashTable.insert("key", 42);
+TEST(HashTableTest, Freeze) {
+    HashTable<int, int> myHashTable;
 
-    for (auto _ : state) {
-        int value = myHashTable.get("key");
-        benchmark::DoNotOptimize(value);
+    for (int i = 0; i < 10000; ++i) {
+        myHashTable.insert(i * 7, i);
     }
-}
-BENCHMARK(BM_Get);
 
-BENCHMARK_MAIN();
+    FrozenHashTable<int, int> frozen = myHashTable.freeze();
+
+    ASSERT_TRUE(frozen.is_open());
+    EXPECT_EQ(frozen.size(), 10000u);
+
+    for (int i = 0; i < 10000; ++i) {
+        EXPECT_EQ(frozen.find(i * 7), std::optional<int>(i));
+    }
+
+    EXPECT_EQ(frozen.find(1), std::nullopt);
+    EXPECT_EQ(frozen.find(-7), std::nullopt);
+    EXPECT_EQ(std::distance(frozen.begin(), frozen.end()), 10000);
+
+    frozen.save("binary_frozen.bin");
+    FrozenHashTable<int, int> mapped("binary_frozen.bin");
+
+    ASSERT_TRUE(mapped.is_open());
+    EXPECT_EQ(mapped.size(), 10000u);
+    EXPECT_EQ(mapped.get(7 * 9999), 9999);
+    EXPECT_FALSE(mapped.contains(3));
+
+    myHashTable.serializeBinary("binary_dump.bin", 4);
+    ASSERT_TRUE((HashTable<int, int>::freezeDump("binary_dump.bin", "binary_frozen_dump.bin", 4)));
+
+    FrozenHashTable<int, int> built("binary_frozen_dump.bin");
+
+    EXPECT_EQ(built.size(), 10000u);
+    EXPECT_EQ(built.find(700), std::optional<int>(100));
+
+    FrozenHashTable<int, int> empty = HashTable<int, int>().freeze();
+
+    ASSERT_TRUE(empty.is_open());
+    EXPECT_TRUE(empty.isEmpty());
+    EXPECT_EQ(empty.find(0), std::nullopt);
+    EXPECT_TRUE(empty.begin() == empty.end());
+
+    empty.save("binary_frozen_empty.bin");
+    FrozenHashTable<int, int> emptyMapped("binary_frozen_empty.bin");
+
+    ASSERT_TRUE(emptyMapped.is_open());
+    EXPECT_TRUE(emptyMapped.isEmpty());
+    EXPECT_FALSE(emptyMapped.contains(0));
+
+    HashTable<int, int>().serializeBinary("binary_dump_empty.bin", 4);
+    EXPECT_TRUE((HashTable<int, int>::freezeDump("binary_dump_empty.bin", "binary_frozen_empty.bin", 4)));
+    EXPECT_TRUE((FrozenHashTable<int, int>("binary_frozen_empty.bin").is_open()));
+
+    FrozenHashTable<int, int> invalid("binary_dump.bin");
+
+    EXPECT_FALSE(invalid.is_open());
+    EXPECT_EQ(invalid.find(7), std::nullopt);
+
+    // A remap entry past the last slot must not be mapped.
+    std::vector<char> image;
+    {
+        std::ifstream in("binary_frozen.bin", std::ios::binary);
+        image.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    uint64_t shape[3];
+    std::memcpy(shape, image.data() + sizeof(BinaryHeader), sizeof(shape));
+    ASSERT_GT(shape[2], 10000u);
+
+    uint64_t pastEnd = 10000;
+    size_t remapOffset = sizeof(BinaryHeader) + sizeof(shape) + ((shape[1] * sizeof(uint32_t) + 7) & ~size_t(7));
+    std::memcpy(image.data() + remapOffset, &pastEnd, sizeof(pastEnd));
+    {
+        std::ofstream out("binary_frozen_corrupt.bin", std::ios::binary);
+        out.write(image.data(), image.size());
+    }
+
+    FrozenHashTable<int, int> corrupt("binary_frozen_corrupt.bin");
+
+    EXPECT_FALSE(corrupt.is_open());
+}
 
 int main(int argc, char** argv) {
     HashTable<std::string, int> myHashTable;
@@ -0,0 +1,736 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <sstream>
+#include <fstream>
+#include <algorithm>
+#include <thread>
+#include <optional>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "binaryIO.h"
+#include "diagnostics.h"
+#include "asyncWriter.h"
+#include "textIO.h"
+#include "instrumentation.h"
+#include "bloomFilter.h"
+#include "hashMix.h"
+#include "keySlot.h"
+#include "frozenHashTable.h"
+#include "workStealing.h"
+
+template <typename Key, typename Value>
+class HashTable {
+private:
+    static const size_t TABLE_SIZE = 10;
+    static const size_t MAX_LOAD_PERCENT = 70;
+
+    struct HashNode {
+        KeySlot<Key> key;
+        Value value;
+        bool occupied;
+
+        HashNode() : occupied(false) {}
+    };
+
+    std::vector<HashNode> table;
+    size_t count;
+
+    // Keys that do not fit in their slot; see keySlot.h. Unused unless Key is
+    // std::string.
+    KeyArena arena;
+    size_t arenaCounted;
+
+    // Optional front for lookups; see enableFilter. Removed keys keep their
+    // bits until staleRemovals exceeds the entry count and it is rebuilt.
+    std::optional<BlockedBloomFilter> filter;
+    size_t staleRemovals;
+
+    size_t homeOf(size_t hash) const {
+        return hash % table.size();
+    }
+
+    static const size_t NOT_FOUND = SIZE_MAX;
+
+    size_t findIndex(const Key& key) const {
+        size_t hash = std::hash<Key>{}(key);
+        Counters::operation();
+
+        if (filter && !filter->mayContain(mixHash(hash))) {
+            Counters::lookup(0);
+            return NOT_FOUND;
+        }
+
+        size_t index = homeOf(hash);
+        size_t probes = 1;
+
+        while (table[index].occupied) {
+            if (table[index].key.matches(hash, key, arena)) {
+                Counters::lookup(probes);
+                return index;
+            }
+
+            index = nextIndex(index);
+            ++probes;
+        }
+
+        Counters::lookup(probes);
+        return NOT_FOUND;
+    }
+
+    size_t nextIndex(size_t index) const {
+        return index + 1 == table.size() ? 0 : index + 1;
+    }
+
+    void rehash(size_t capacity) {
+        std::vector<HashNode> old(capacity);
+        Counters::allocated(capacity * sizeof(HashNode), capacity);
+        old.swap(table);
+
+        for (auto& node : old) {
+            if (node.occupied) {
+                size_t index = homeOf(node.key.hash());
+
+                while (table[index].occupied) {
+                    index = nextIndex(index);
+                }
+
+                table[index] = std::move(node);
+            }
+        }
+
+        Counters::released(old.size() * sizeof(HashNode), old.size());
+
+        if (arena.garbage() > 0) {
+            compactKeys();
+        }
+
+        if (filter) {
+            rebuildFilter();
+        }
+    }
+
+    // Moves the live keys into a fresh arena, leaving the garbage behind.
+    void compactKeys() {
+        KeyArena compacted;
+        compacted.reserve(arena.size() - arena.garbage());
+
+        for (auto& node : table) {
+            if (node.occupied) {
+                node.key.relocate(arena, compacted);
+            }
+        }
+
+        arena = std::move(compacted);
+        trackArena();
+    }
+
+    // Keeps LiveBytes in step with the arena, which grows like a vector.
+    void trackArena() {
+        if (arena.capacity() != arenaCounted) {
+            Counters::released(arenaCounted, 0);
+            Counters::allocated(arena.capacity(), 0);
+            arenaCounted = arena.capacity();
+        }
+    }
+
+    typename KeySlot<Key>::View keyOf(const HashNode& node) const {
+        return node.key.view(arena);
+    }
+
+    // Sized for the most entries the table holds before it grows.
+    void rebuildFilter() {
+        dropFilter();
+        filter.emplace(table.size() * MAX_LOAD_PERCENT / 100);
+        Counters::allocated(filter->bytes(), 0);
+
+        for (const auto& node : table) {
+            if (node.occupied) {
+                filter->insert(mixHash(node.key.hash()));
+            }
+        }
+
+        staleRemovals = 0;
+    }
+
+    void dropFilter() {
+        if (filter) {
+            Counters::released(filter->bytes(), 0);
+            filter.reset();
+        }
+    }
+
+    // Places an entry whose probe chain stays inside [begin, end), and returns
+    // false without touching the table when the chain would leave the range.
+    // Threads working on disjoint ranges can therefore fill the table at once;
+    // new arena keys go to the space each range set aside, starting at cursor.
+    bool placeWithin(Key& key, Value& value, size_t begin, size_t end, size_t& added, uint64_t& cursor) {
+        size_t hash = std::hash<Key>{}(key);
+        size_t index = homeOf(hash);
+
+        if (index < begin || index >= end) {
+            return false;
+        }
+
+        while (index < end && table[index].occupied && !table[index].key.matches(hash, key, arena)) {
+            ++index;
+        }
+
+        if (index == end) {
+            return false;
+        }
+
+        Counters::operation();
+
+        if (!table[index].occupied) {
+            ++added;
+            table[index].key.assignAt(key, hash, arena, cursor);
+            table[index].occupied = true;
+        }
+
+        table[index].value = std::move(value);
+        return true;
+    }
+
+    template <typename T>
+    static uint64_t entryBytes(const T& value) {
+        if constexpr (std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view>) {
+            return sizeof(uint64_t) + value.size();
+        }
+        else {
+            return sizeof(T);
+        }
+    }
+
+    // Smallest number of bytes one stored key or value can take: strings are a
+    // length followed by their bytes.
+    template <typename U>
+    static constexpr size_t storedBytes() {
+        return std::is_same_v<U, std::string> ? sizeof(uint64_t) : sizeof(U);
+    }
+
+    // Every segment of a dump has to lie between the directory and the end of
+    // the file and be large enough for its entries, and the entries of all
+    // segments have to add up to the header's count.
+    static bool validDirectory(const std::vector<uint64_t>& directory, uint64_t directoryEnd, uint64_t fileSize,
+                               uint64_t expectedCount) {
+        uint64_t total = 0;
+
+        for (size_t segment = 0; segment < directory.size() / 3; ++segment) {
+            uint64_t offset = directory[3 * segment];
+            uint64_t size = directory[3 * segment + 1];
+            uint64_t entries = directory[3 * segment + 2];
+
+            if (offset < directoryEnd || offset > fileSize || size > fileSize - offset
+                || entries > size / (storedBytes<Key>() + storedBytes<Value>()) || entries > expectedCount - total) {
+                return false;
+            }
+
+            total += entries;
+        }
+
+        return total == expectedCount;
+    }
+
+    // Runs task(0) to task(tasks - 1) as tasks on the shared work-stealing pool
+    // and returns when all are done. A grain of 1 hands each index to its own
+    // task.
+    template <typename Task>
+    static void forEachTask(size_t tasks, const Task& task) {
+        ThreadPool::shared().parallelFor(0, tasks, 1, [&task](size_t index, size_t) { task(index); });
+    }
+
+    // Linear probing must not leave a hole inside a probe chain, so entries after
+    // a removed slot are shifted back unless that would move them before their home.
+    void closeGap(size_t hole) {
+        size_t index = nextIndex(hole);
+
+        while (table[index].occupied) {
+            size_t home = homeOf(table[index].key.hash());
+            bool movable = index > hole ? (home <= hole || home > index) : (home <= hole && home > index);
+
+            if (movable) {
+                table[hole] = std::move(table[index]);
+                table[index].occupied = false;
+                hole = index;
+            }
+
+            index = nextIndex(index);
+        }
+    }
+
+public:
+    // Allocation, operation and probe counts of every table of this type, all
+    // zero unless built with CONTAINER_INSTRUMENTATION; see instrumentation.h.
+    // Nodes are slots here: LiveNodes is the capacity of the slot arrays.
+    using Counters = CountersFor<HashTable>;
+
+    static CounterSnapshot counters() {
+        return Counters::snapshot();
+    }
+
+    HashTable() : table(TABLE_SIZE), count(0), arenaCounted(0), staleRemovals(0) {
+        Counters::allocated(TABLE_SIZE * sizeof(HashNode), TABLE_SIZE);
+    }
+
+    HashTable(const HashTable&) = delete;
+    HashTable& operator=(const HashTable&) = delete;
+
+    ~HashTable() {
+        Counters::released(table.size() * sizeof(HashNode), table.size());
+        Counters::released(arenaCounted, 0);
+        dropFilter();
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    // Memory held by the slot array, the key arena and the filter.
+    size_t bytes() const {
+        return table.capacity() * sizeof(HashNode) + arena.capacity() + (filter ? filter->bytes() : 0);
+    }
+
+    // Puts a blocked Bloom filter of about 10 bits per entry in front of
+    // lookups, so that most misses are answered from one cache line instead of
+    // a walk to the end of a probe chain; about 1% still probe. insert keeps it
+    // up to date and it is rebuilt whenever the table grows. Binary dumps carry
+    // it along, and loading a dump that has one enables it.
+    void enableFilter() {
+        rebuildFilter();
+    }
+
+    void disableFilter() {
+        dropFilter();
+    }
+
+    bool hasFilter() const {
+        return filter.has_value();
+    }
+
+    void reserve(size_t entries) {
+        size_t capacity = table.size();
+
+        while (entries * 100 > capacity * MAX_LOAD_PERCENT) {
+            capacity *= 2;
+        }
+
+        if (capacity != table.size()) {
+            rehash(capacity);
+        }
+    }
+
+    void insert(const Key& key, const Value& value) {
+        Counters::operation();
+        reserve(count + 1);
+
+        size_t hash = std::hash<Key>{}(key);
+        size_t index = homeOf(hash);
+
+        while (table[index].occupied && !table[index].key.matches(hash, key, arena)) {
+            index = nextIndex(index);
+        }
+
+        if (!table[index].occupied) {
+            ++count;
+            table[index].key.assign(key, hash, arena);
+            table[index].occupied = true;
+            trackArena();
+        }
+
+        table[index].value = value;
+
+        if (filter) {
+            filter->insert(mixHash(hash));
+        }
+    }
+
+    void remove(const Key& key) {
+        if (!tryRemove(key)) {
+            diagnose("An element with a key ", key, " not found.");
+        }
+    }
+
+    // Returns whether the key was present, without any diagnostic output.
+    bool tryRemove(const Key& key) {
+        size_t index = findIndex(key);
+
+        if (index == NOT_FOUND) {
+            return false;
+        }
+
+        table[index].key.release(arena);
+        table[index].occupied = false;
+        --count;
+        closeGap(index);
+
+        if (arena.garbage() > arena.size() / 2) {
+            compactKeys();
+        }
+
+        if (filter && ++staleRemovals > count) {
+            rebuildFilter();
+        }
+
+        return true;
+    }
+
+    Value get(const Key& key) const {
+        size_t index = findIndex(key);
+
+        if (index == NOT_FOUND) {
+            diagnose("An element with a key ", key, " not found.");
+            return Value();
+        }
+
+        return table[index].value;
+    }
+
+    // The value stored under key, or std::nullopt on a miss, without any
+    // diagnostic output.
+    std::optional<Value> find(const Key& key) const {
+        size_t index = findIndex(key);
+
+        if (index == NOT_FOUND) {
+            return std::nullopt;
+        }
+
+        return table[index].value;
+    }
+
+    std::string serializeText() const {
+        std::string text;
+
+        for (const auto& node : table) {
+            if (node.occupied) {
+                appendText(text, keyOf(node));
+                text += ':';
+                appendText(text, node.value);
+                text += ' ';
+            }
+        }
+
+        Counters::serialized(text.size());
+        return text;
+    }
+
+    bool serializeText(int fd) const {
+        TextWriter writer(fd);
+
+        for (const auto& node : table) {
+            if (node.occupied) {
+                writer.write(keyOf(node));
+                writer.write(":");
+                writer.write(node.value);
+                writer.write(" ");
+            }
+        }
+
+        writer.flush();
+        Counters::serialized(writer.bytesWritten());
+        return writer.good();
+    }
+
+    void deserializeText(const std::string& data) {
+
+        TextReader reader(data);
+        std::string_view keyValue;
+
+        while (reader.nextToken(keyValue)) {
+            size_t delimiterPos = keyValue.find(':');
+            Key key;
+            Value value;
+
+            if (delimiterPos != std::string_view::npos && parseText(keyValue.substr(0, delimiterPos), key)
+                && parseText(keyValue.substr(delimiterPos + 1), value)) {
+                insert(key, value);
+            }
+        }
+    }
+
+    // The occupied slots are split into up to `threads` independent segments,
+    // encoded as tasks on the shared ThreadPool and then written at precomputed
+    // offsets with pwrite. After
+    // the header comes the segment count and one (offset, bytes, entries) triple
+    // per segment. A table with a filter appends it after the last segment.
+    void serializeBinary(const std::string& filename, size_t threads = 1) const {
+        int fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+        if (fd < 0) {
+            std::cerr << "Unable to open the file for binary serialization." << std::endl;
+            return;
+        }
+
+        size_t segmentCount = std::max<size_t>(1, std::min(threads, table.size()));
+        std::vector<BufferWriter> segments(segmentCount);
+        std::vector<uint64_t> entries(segmentCount, 0);
+
+        forEachTask(segmentCount, [&](size_t segment) {
+            size_t begin = table.size() * segment / segmentCount;
+            size_t end = table.size() * (segment + 1) / segmentCount;
+
+            for (size_t index = begin; index < end; ++index) {
+                if (table[index].occupied) {
+                    segments[segment].writeValue(keyOf(table[index]));
+                    segments[segment].writeValue(table[index].value);
+                    ++entries[segment];
+                }
+            }
+        });
+
+        BufferWriter directory;
+        directory.writeValue(BinaryHeader(sizeof(Key) + sizeof(Value), count));
+        directory.writeValue(static_cast<uint64_t>(segmentCount));
+
+        std::vector<uint64_t> offsets(segmentCount);
+        uint64_t offset = sizeof(BinaryHeader) + sizeof(uint64_t) * (1 + 3 * segmentCount);
+
+        for (size_t segment = 0; segment < segmentCount; ++segment) {
+            offsets[segment] = offset;
+            directory.writeValue(offset);
+            directory.writeValue(static_cast<uint64_t>(segments[segment].size()));
+            directory.writeValue(entries[segment]);
+            offset += segments[segment].size();
+        }
+
+        bool written = pwriteAll(fd, directory.data(), directory.size(), 0);
+
+        if (filter) {
+            BufferWriter filterBytes;
+            filter->write(filterBytes);
+            written = written && pwriteAll(fd, filterBytes.data(), filterBytes.size(), offset);
+            offset += filterBytes.size();
+        }
+
+        std::vector<char> segmentWritten(segmentCount, 0);
+
+        forEachTask(segmentCount, [&](size_t segment) {
+            segmentWritten[segment] = pwriteAll(fd, segments[segment].data(), segments[segment].size(), offsets[segment]);
+        });
+
+        if (!written || std::count(segmentWritten.begin(), segmentWritten.end(), 0) > 0) {
+            std::cerr << "Unable to write the binary serialization." << std::endl;
+        }
+        else {
+            Counters::serialized(offset);
+        }
+
+        ::close(fd);
+    }
+
+    // Writes the same layout as serializeBinary with a single segment whose byte
+    // size is patched in once the entries are queued.
+    std::future<bool> serializeBinaryAsync(const std::string& filename, AsyncWriter& writer = AsyncWriter::shared()) const {
+        AsyncWriter::Snapshot snapshot = writer.begin(filename);
+        uint64_t offset = sizeof(BinaryHeader) + sizeof(uint64_t) * 4;
+        uint64_t bytes = 0;
+
+        snapshot.writeHeader(sizeof(Key) + sizeof(Value), count);
+        snapshot.writeValue(uint64_t(1));
+        snapshot.writeValue(offset);
+        snapshot.writeValue(bytes);
+        snapshot.writeValue(static_cast<uint64_t>(count));
+
+        for (const auto& node : table) {
+            if (node.occupied) {
+                snapshot.writeValue(keyOf(node));
+                snapshot.writeValue(node.value);
+                bytes += entryBytes(keyOf(node)) + entryBytes(node.value);
+            }
+        }
+
+        if (filter) {
+            filter->write(snapshot);
+        }
+
+        snapshot.patch(sizeof(BinaryHeader) + sizeof(uint64_t) * 2, &bytes, sizeof(bytes));
+        return snapshot.finish();
+    }
+
+    // Segments are read and decoded as tasks on the shared ThreadPool and their
+    // entries bucketed into `threads` slot ranges by hash; each range is then
+    // filled by one task. Entries whose probe chain would cross into the next
+    // range are inserted afterwards on the calling thread.
+    void deserializeBinary(const std::string& filename, size_t threads = std::thread::hardware_concurrency()) {
+        int fd = ::open(filename.c_str(), O_RDONLY);
+
+        if (fd < 0) {
+            std::cerr << "Unable to open the file for binary deserialization." << std::endl;
+            return;
+        }
+
+        BinaryHeader header;
+        uint64_t segmentCount = 0;
+        struct stat info;
+
+        if (::fstat(fd, &info) != 0 || static_cast<uint64_t>(info.st_size) < sizeof(header) + sizeof(segmentCount)
+            || !preadAll(fd, &header, sizeof(header), 0) || !header.isValid(sizeof(Key) + sizeof(Value))
+            || header.encoding != BinaryEncoding::Raw
+            || !preadAll(fd, &segmentCount, sizeof(segmentCount), sizeof(header))
+            || segmentCount > (info.st_size - sizeof(header) - sizeof(segmentCount)) / (3 * sizeof(uint64_t))) {
+            std::cerr << "Invalid binary header." << std::endl;
+            ::close(fd);
+            return;
+        }
+
+        std::vector<uint64_t> directory(3 * segmentCount);
+        uint64_t fileSize = info.st_size;
+
+        // Anything after the last segment is a filter.
+        uint64_t payloadEnd = sizeof(header) + sizeof(uint64_t) * (1 + directory.size());
+
+        if (!preadAll(fd, directory.data(), directory.size() * sizeof(uint64_t), sizeof(header) + sizeof(uint64_t))
+            || !validDirectory(directory, payloadEnd, fileSize, header.count)) {
+            std::cerr << "Invalid binary header." << std::endl;
+            ::close(fd);
+            return;
+        }
+
+        for (uint64_t segment = 0; segment < segmentCount; ++segment) {
+            payloadEnd = std::max(payloadEnd, directory[3 * segment] + directory[3 * segment + 1]);
+        }
+
+        std::optional<BlockedBloomFilter> storedFilter;
+
+        if (fileSize > payloadEnd) {
+            std::vector<char> bytes(info.st_size - payloadEnd);
+            BufferReader reader(bytes.data(), bytes.size());
+            storedFilter.emplace();
+
+            if (!preadAll(fd, bytes.data(), bytes.size(), payloadEnd) || !storedFilter->read(reader, bytes.size())) {
+                std::cerr << "Invalid filter." << std::endl;
+                storedFilter.reset();
+            }
+        }
+
+        size_t existing = count;
+        reserve(count + header.count);
+
+        size_t workers = std::max<size_t>(1, std::min<size_t>(threads, segmentCount));
+        size_t partitions = std::max<size_t>(1, threads);
+        std::vector<std::vector<std::vector<std::pair<Key, Value>>>> buckets(
+            workers, std::vector<std::vector<std::pair<Key, Value>>>(partitions));
+
+        forEachTask(workers, [&](size_t worker) {
+            std::vector<char> bytes;
+
+            for (size_t segment = worker; segment < segmentCount; segment += workers) {
+                bytes.resize(directory[3 * segment + 1]);
+
+                if (!preadAll(fd, bytes.data(), bytes.size(), directory[3 * segment])) {
+                    continue;
+                }
+
+                BufferReader reader(bytes.data(), bytes.size());
+                Key key;
+                Value value;
+
+                for (uint64_t i = 0; i < directory[3 * segment + 2]; ++i) {
+                    if (!reader.readValue(key) || !reader.readValue(value)) {
+                        break;
+                    }
+
+                    size_t partition = homeOf(std::hash<Key>{}(key)) * partitions / table.size();
+                    buckets[worker][partition].emplace_back(std::move(key), std::move(value));
+                }
+            }
+        });
+
+        ::close(fd);
+
+        std::vector<std::vector<std::pair<Key, Value>>> deferred(partitions);
+        std::vector<size_t> added(partitions, 0);
+
+        // Every range sets aside arena space for all of its keys; what is left
+        // unused by keys that were already present or deferred is garbage.
+        std::vector<uint64_t> reserved(partitions, 0);
+        std::vector<uint64_t> cursors(partitions, 0);
+
+        for (size_t partition = 0; partition < partitions; ++partition) {
+            for (auto& bucket : buckets) {
+                for (auto& entry : bucket[partition]) {
+                    reserved[partition] += KeySlot<Key>::arenaBytes(entry.first);
+                }
+            }
+
+            cursors[partition] = arena.extend(reserved[partition]);
+        }
+
+        std::vector<uint64_t> starts(cursors);
+
+        forEachTask(partitions, [&](size_t partition) {
+            size_t begin = table.size() * partition / partitions;
+            size_t end = table.size() * (partition + 1) / partitions;
+
+            for (auto& bucket : buckets) {
+                for (auto& entry : bucket[partition]) {
+                    if (!placeWithin(entry.first, entry.second, begin, end, added[partition], cursors[partition])) {
+                        deferred[partition].push_back(std::move(entry));
+                    }
+                }
+            }
+        });
+
+        for (size_t partition = 0; partition < partitions; ++partition) {
+            count += added[partition];
+            arena.release(reserved[partition] - (cursors[partition] - starts[partition]));
+        }
+
+        trackArena();
+
+        for (size_t partition = 0; partition < partitions; ++partition) {
+
+            for (auto& entry : deferred[partition]) {
+                insert(entry.first, entry.second);
+            }
+        }
+
+        // The ranges were filled without the filter. A stored filter covers
+        // exactly the loaded keys, so it can be taken over by a table that was
+        // empty; otherwise the filter is built from the table.
+        if (storedFilter && existing == 0) {
+            dropFilter();
+            filter = std::move(storedFilter);
+            Counters::allocated(filter->bytes(), 0);
+            staleRemovals = 0;
+        }
+        else if (storedFilter || filter) {
+            rebuildFilter();
+        }
+    }
+
+    // Read-only copy indexed by a minimal perfect hash: one slot read per
+    // lookup and no empty slots; see frozenHashTable.h. Needs trivially
+    // copyable keys and values. The copy is empty if two keys hash equal or,
+    // rarely, if no perfect hash was found; FrozenHashTable says which.
+    FrozenHashTable<Key, Value> freeze() const {
+        std::vector<std::pair<Key, Value>> entries;
+        entries.reserve(count);
+
+        for (const auto& node : table) {
+            if (node.occupied) {
+                entries.emplace_back(keyOf(node), node.value);
+            }
+        }
+
+        return FrozenHashTable<Key, Value>(entries);
+    }
+
+    // Offline builder: turns a serializeBinary dump into a frozen table file
+    // that FrozenHashTable maps directly.
+    static bool freezeDump(const std::string& dumpFile, const std::string& frozenFile,
+                           size_t threads = std::thread::hardware_concurrency()) {
+        HashTable loaded;
+        loaded.deserializeBinary(dumpFile, threads);
+        FrozenHashTable<Key, Value> frozen = loaded.freeze();
+
+        if (!frozen.is_open()) {
+            return false;
+        }
+
+        frozen.save(frozenFile);
+        return true;
+    }
+};
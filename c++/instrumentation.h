@@ -0,0 +1,187 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+// Compile with -DCONTAINER_INSTRUMENTATION=1 to have every container count its
+// allocations and operations. Without it the counting policy is NoCounters,
+// whose hooks are empty, so the default build carries no counting code at all.
+#ifndef CONTAINER_INSTRUMENTATION
+#define CONTAINER_INSTRUMENTATION 0
+#endif
+
+constexpr bool INSTRUMENTATION_ENABLED = CONTAINER_INSTRUMENTATION != 0;
+
+enum class Counter : size_t {
+    LiveNodes,       // nodes (slots for HashTable) currently held
+    LiveBytes,       // bytes of those nodes
+    Allocations,     // allocations made so far
+    BytesAllocated,  // bytes of those allocations
+    Operations,      // elements added, removed or looked up
+    SerializedBytes, // bytes produced by serializeText and serializeBinary
+    Lookups,         // key lookups, HashTable only
+    Probes,          // slots inspected by those lookups
+    COUNT
+};
+
+// Totals of one container type, summed over all threads. Subtracting two
+// snapshots gives the activity between them; LiveNodes and LiveBytes are
+// meaningful as absolute values too.
+struct CounterSnapshot {
+    std::array<int64_t, static_cast<size_t>(Counter::COUNT)> values{};
+
+    int64_t operator[](Counter counter) const {
+        return values[static_cast<size_t>(counter)];
+    }
+
+    CounterSnapshot operator-(const CounterSnapshot& other) const {
+        CounterSnapshot difference;
+
+        for (size_t index = 0; index < values.size(); ++index) {
+            difference.values[index] = values[index] - other.values[index];
+        }
+
+        return difference;
+    }
+
+    double allocationsPerOperation() const {
+        return ratio(Counter::Allocations, Counter::Operations);
+    }
+
+    double probesPerLookup() const {
+        return ratio(Counter::Probes, Counter::Lookups);
+    }
+
+private:
+    double ratio(Counter numerator, Counter denominator) const {
+        int64_t divisor = (*this)[denominator];
+        return divisor == 0 ? 0.0 : static_cast<double>((*this)[numerator]) / divisor;
+    }
+};
+
+// Counting policy of the default build.
+struct NoCounters {
+    static constexpr bool enabled = false;
+
+    static void allocated(size_t, int64_t = 1) {}
+    static void released(size_t, int64_t = 1) {}
+    static void operation(int64_t = 1) {}
+    static void serialized(uint64_t) {}
+    static void lookup(size_t) {}
+
+    static CounterSnapshot snapshot() {
+        return CounterSnapshot();
+    }
+};
+
+// Counting policy of instrumented builds, one set of counters per Tag. Every
+// thread adds to its own block with relaxed loads and stores, so counting never
+// contends; snapshot() sums the blocks of live threads and the totals left by
+// threads that have exited.
+template <typename Tag>
+class ThreadCounters {
+public:
+    static constexpr bool enabled = true;
+
+    static void allocated(size_t bytes, int64_t nodes = 1) {
+        Block& block = local();
+        block.add(Counter::LiveNodes, nodes);
+        block.add(Counter::LiveBytes, bytes);
+        block.add(Counter::Allocations, 1);
+        block.add(Counter::BytesAllocated, bytes);
+    }
+
+    static void released(size_t bytes, int64_t nodes = 1) {
+        Block& block = local();
+        block.add(Counter::LiveNodes, -nodes);
+        block.add(Counter::LiveBytes, -static_cast<int64_t>(bytes));
+    }
+
+    static void operation(int64_t count = 1) {
+        local().add(Counter::Operations, count);
+    }
+
+    static void serialized(uint64_t bytes) {
+        local().add(Counter::SerializedBytes, bytes);
+    }
+
+    static void lookup(size_t probes) {
+        Block& block = local();
+        block.add(Counter::Lookups, 1);
+        block.add(Counter::Probes, probes);
+    }
+
+    static CounterSnapshot snapshot() {
+        Registry& shared = registry();
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        CounterSnapshot total = shared.retired;
+
+        for (const Block* block : shared.blocks) {
+            block->addTo(total);
+        }
+
+        return total;
+    }
+
+private:
+    struct Block;
+
+    struct Registry {
+        std::mutex mutex;
+        std::vector<Block*> blocks;
+        CounterSnapshot retired;
+    };
+
+    struct Block {
+        std::array<std::atomic<int64_t>, static_cast<size_t>(Counter::COUNT)> values{};
+
+        Block() {
+            Registry& shared = registry();
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            shared.blocks.push_back(this);
+        }
+
+        ~Block() {
+            Registry& shared = registry();
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            addTo(shared.retired);
+            shared.blocks.erase(std::find(shared.blocks.begin(), shared.blocks.end(), this));
+        }
+
+        // Only the owning thread writes, so a load and a store are enough.
+        void add(Counter counter, int64_t amount) {
+            std::atomic<int64_t>& value = values[static_cast<size_t>(counter)];
+            value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+        }
+
+        void addTo(CounterSnapshot& total) const {
+            for (size_t index = 0; index < values.size(); ++index) {
+                total.values[index] += values[index].load(std::memory_order_relaxed);
+            }
+        }
+    };
+
+    // Never destroyed: workers of a static ThreadPool exit during static
+    // destruction, possibly after a registry created later than the pool would
+    // already be gone, and their blocks still retire into it.
+    static Registry& registry() {
+        static Registry* shared = new Registry();
+        return *shared;
+    }
+
+    static Block& local() {
+        thread_local Block block;
+        return block;
+    }
+};
+
+// The policy a container instantiates: ThreadCounters<Container> in instrumented
+// builds, NoCounters otherwise.
+template <typename Container>
+using CountersFor = std::conditional_t<INSTRUMENTATION_ENABLED, ThreadCounters<Container>, NoCounters>;
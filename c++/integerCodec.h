@@ -0,0 +1,258 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+#include "binaryIO.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define DELTA_VARINT_SHUFFLE 1
+#include <tmmintrin.h>
+#endif
+
+// Compressed payload for integral dumps. Each value is replaced by the zigzag
+// encoding of its difference from the previous one, so runs of increasing IDs
+// shrink to one or two bytes. Values are stored in pairs: one control byte holds
+// the byte lengths (1..8) of both values, and the control bytes are kept apart
+// from the value bytes so a pair can be decoded with a single byte shuffle.
+//
+// Payload layout after the BinaryHeader:
+//   uint64 control byte count, uint64 data byte count, control bytes, data bytes.
+inline uint64_t zigzagEncode(uint64_t delta) {
+    return (delta << 1) ^ static_cast<uint64_t>(static_cast<int64_t>(delta) >> 63);
+}
+
+inline uint64_t zigzagDecode(uint64_t value) {
+    return (value >> 1) ^ (0 - (value & 1));
+}
+
+inline unsigned byteLength(uint64_t value) {
+    return value == 0 ? 1 : (64 - __builtin_clzll(value) + 7) / 8;
+}
+
+struct PairTables {
+    std::array<std::array<uint8_t, 16>, 256> shuffle;
+    std::array<uint8_t, 256> length;
+
+    PairTables() : shuffle(), length() {
+        for (unsigned control = 0; control < 256; ++control) {
+            unsigned first = (control & 0x0F) + 1;
+            unsigned second = (control >> 4) + 1;
+
+            if (first > 8 || second > 8) {
+                continue;
+            }
+
+            length[control] = first + second;
+
+            for (unsigned byte = 0; byte < 8; ++byte) {
+                shuffle[control][byte] = byte < first ? byte : 0x80;
+                shuffle[control][8 + byte] = byte < second ? first + byte : 0x80;
+            }
+        }
+    }
+};
+
+inline const PairTables& pairTables() {
+    static const PairTables tables;
+    return tables;
+}
+
+// How DeltaVarintDecoder unpacks a pair: with one SSSE3 byte shuffle where the
+// CPU has it, or with two short copies anywhere. The shuffle is compiled for
+// SSSE3 on its own, so the build needs no -mssse3 and the choice is made at run
+// time.
+enum class PairDecoding {
+    Scalar,
+    Shuffle
+};
+
+inline bool shuffleSupported() {
+#if defined(DELTA_VARINT_SHUFFLE)
+    static const bool supported = __builtin_cpu_supports("ssse3");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+inline PairDecoding bestPairDecoding() {
+    return shuffleSupported() ? PairDecoding::Shuffle : PairDecoding::Scalar;
+}
+
+// Extra bytes kept readable after the data so every pair can be loaded as one
+// unaligned 16-byte block.
+const size_t DELTA_VARINT_PADDING = 16;
+
+template <typename T>
+class DeltaVarintEncoder {
+    static_assert(std::is_integral_v<T> && sizeof(T) <= 8, "delta-varint encoding requires an integral type");
+
+public:
+    DeltaVarintEncoder() : previous(0), pending(0), hasPending(false), count(0) {}
+
+    void push(const T& value) {
+        uint64_t current = static_cast<uint64_t>(static_cast<int64_t>(value));
+        uint64_t encoded = zigzagEncode(current - previous);
+        previous = current;
+        ++count;
+
+        if (!hasPending) {
+            pending = encoded;
+            hasPending = true;
+            return;
+        }
+
+        appendPair(pending, encoded);
+        hasPending = false;
+    }
+
+    uint64_t size() const {
+        return count;
+    }
+
+    void write(BinaryWriter& writer) {
+        if (hasPending) {
+            appendPair(pending, 0);
+            hasPending = false;
+        }
+
+        uint64_t controlBytes = controls.size();
+        uint64_t dataBytes = data.size();
+        writer.writeValue(controlBytes);
+        writer.writeValue(dataBytes);
+        writer.write(controls.data(), controls.size());
+        writer.write(data.data(), data.size());
+    }
+
+private:
+    std::vector<uint8_t> controls;
+    std::vector<uint8_t> data;
+    uint64_t previous;
+    uint64_t pending;
+    bool hasPending;
+    uint64_t count;
+
+    void appendPair(uint64_t first, uint64_t second) {
+        unsigned firstLength = byteLength(first);
+        unsigned secondLength = byteLength(second);
+        controls.push_back(static_cast<uint8_t>((firstLength - 1) | ((secondLength - 1) << 4)));
+
+        size_t offset = data.size();
+        data.resize(offset + firstLength + secondLength);
+        std::memcpy(data.data() + offset, &first, firstLength);
+        std::memcpy(data.data() + offset + firstLength, &second, secondLength);
+    }
+};
+
+template <typename T>
+class DeltaVarintDecoder {
+    static_assert(std::is_integral_v<T> && sizeof(T) <= 8, "delta-varint encoding requires an integral type");
+
+public:
+    // A Shuffle request on a CPU without SSSE3 decodes with Scalar.
+    explicit DeltaVarintDecoder(PairDecoding decoding = bestPairDecoding())
+        : decoding(shuffleSupported() ? decoding : PairDecoding::Scalar), control(0), end(0), position(0), previous(0),
+          remaining(0) {}
+
+    PairDecoding pairDecoding() const {
+        return decoding;
+    }
+
+    bool read(BinaryReader& reader, uint64_t count) {
+        uint64_t controlBytes = 0;
+        uint64_t dataBytes = 0;
+
+        if (!reader.readValue(controlBytes) || !reader.readValue(dataBytes) || controlBytes != (count + 1) / 2) {
+            return false;
+        }
+
+        buffer.assign(controlBytes + dataBytes + DELTA_VARINT_PADDING, 0);
+
+        if (!reader.read(buffer.data(), controlBytes + dataBytes)) {
+            return false;
+        }
+
+        control = 0;
+        end = controlBytes;
+        position = controlBytes;
+        remaining = count;
+        previous = 0;
+        return true;
+    }
+
+    // Decodes whole pairs while at least two slots are free in out and returns
+    // how many values were written; capacity must be at least 2.
+    size_t next(T* out, size_t capacity) {
+#if defined(DELTA_VARINT_SHUFFLE)
+        if (decoding == PairDecoding::Shuffle) {
+            return nextShuffle(out, capacity);
+        }
+#endif
+
+        return decodePairs(out, capacity, [](const uint8_t* source, uint8_t code, const PairTables&, uint64_t* pair) {
+            unsigned firstLength = (code & 0x0F) + 1;
+            unsigned secondLength = (code >> 4) + 1;
+            pair[0] = 0;
+            pair[1] = 0;
+            std::memcpy(&pair[0], source, firstLength);
+            std::memcpy(&pair[1], source + firstLength, secondLength);
+        });
+    }
+
+private:
+    std::vector<uint8_t> buffer;
+    PairDecoding decoding;
+    size_t control;
+    size_t end;
+    size_t position;
+    uint64_t previous;
+    uint64_t remaining;
+
+#if defined(DELTA_VARINT_SHUFFLE)
+    __attribute__((target("ssse3"))) size_t nextShuffle(T* out, size_t capacity) {
+        return decodePairs(out, capacity, [](const uint8_t* source, uint8_t code, const PairTables& tables, uint64_t* pair)
+                                              __attribute__((target("ssse3"))) {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source));
+            __m128i mask = _mm_loadu_si128(reinterpret_cast<const __m128i*>(tables.shuffle[code].data()));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pair), _mm_shuffle_epi8(bytes, mask));
+        });
+    }
+#endif
+
+    // The loop shared by both decodings. It is always inlined, so in
+    // nextShuffle it is compiled for SSSE3 and the shuffle inlines into it.
+    template <typename DecodePair>
+    __attribute__((always_inline)) size_t decodePairs(T* out, size_t capacity, DecodePair decodePair) {
+        const PairTables& tables = pairTables();
+        size_t produced = 0;
+
+        while (remaining > 0 && produced + 2 <= capacity && control < end) {
+            uint8_t code = buffer[control++];
+            uint64_t pair[2];
+
+            if (tables.length[code] == 0 || position + tables.length[code] > buffer.size() - DELTA_VARINT_PADDING) {
+                remaining = 0;
+                break;
+            }
+
+            decodePair(buffer.data() + position, code, tables, pair);
+            position += tables.length[code];
+
+            previous += zigzagDecode(pair[0]);
+            out[produced++] = static_cast<T>(previous);
+
+            if (--remaining == 0) {
+                break;
+            }
+
+            previous += zigzagDecode(pair[1]);
+            out[produced++] = static_cast<T>(previous);
+            --remaining;
+        }
+
+        return produced;
+    }
+};
@@ -0,0 +1,251 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "binaryIO.h"
+
+enum class FsyncPolicy {
+    Never,
+    OnCommit
+};
+
+struct JournalOptions {
+    size_t batchSize = 256;
+    FsyncPolicy fsyncPolicy = FsyncPolicy::OnCommit;
+};
+
+// Write-ahead journal for containers that change through push and pop.
+//
+// State lives in numbered files next to a base path: "<base>.snapshot.<g>" holds
+// the container after every journal segment below g has been applied, and
+// "<base>.journal.<g>" holds the operations recorded while segment g was
+// current. Recovery loads the newest snapshot and replays the segments from its
+// number on. Records are buffered and written in groups of batchSize with one
+// write(2), followed by fdatasync when the policy asks for it.
+//
+// compact() starts a new segment and folds the older ones into a fresh snapshot
+// on a background thread. The snapshot is renamed into place before the folded
+// segments are removed, so a crash at any point leaves a recoverable set of files.
+template <typename Container, typename T>
+class Journal {
+public:
+    Journal(const std::string& base, JournalOptions options)
+        : base(base), options(options), fd(-1), pendingRecords(0), generation(0) {
+        uint64_t lastSegment = latestSegment(base);
+        generation = latestSnapshot(base);
+
+        if (lastSegment != NONE) {
+            generation = std::max(generation, lastSegment + 1);
+        }
+
+        openSegment();
+    }
+
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    ~Journal() {
+        commit();
+        waitForCompaction();
+
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    void recordPush(const T& value) {
+        pending.writeValue(PUSH);
+        pending.writeValue(value);
+        recorded();
+    }
+
+    void recordPop() {
+        pending.writeValue(POP);
+        recorded();
+    }
+
+    void commit() {
+        const char* data = pending.data();
+        size_t size = pending.size();
+
+        while (size > 0 && fd >= 0) {
+            ssize_t result = ::write(fd, data, size);
+
+            if (result <= 0) {
+                std::cerr << "Unable to write the journal." << std::endl;
+                break;
+            }
+
+            data += result;
+            size -= result;
+        }
+
+        if (pending.size() > 0 && options.fsyncPolicy == FsyncPolicy::OnCommit && fd >= 0) {
+            ::fdatasync(fd);
+        }
+
+        pending.clear();
+        pendingRecords = 0;
+    }
+
+    void compact() {
+        commit();
+        waitForCompaction();
+
+        ::close(fd);
+        uint64_t folded = generation++;
+        openSegment();
+
+        compaction = std::thread([base = base, folded]() {
+            uint64_t first = latestSnapshot(base);
+            Container snapshot;
+            replay(snapshot, base, folded);
+
+            std::string target = snapshotPath(base, folded + 1);
+            std::string temporary = target + ".tmp";
+            snapshot.serializeBinary(temporary);
+            syncFile(temporary);
+
+            if (std::rename(temporary.c_str(), target.c_str()) != 0) {
+                std::cerr << "Unable to install the compacted snapshot." << std::endl;
+                return;
+            }
+
+            for (uint64_t old = first; old <= folded; ++old) {
+                std::remove(segmentPath(base, old).c_str());
+                std::remove(snapshotPath(base, old).c_str());
+            }
+        });
+    }
+
+    void waitForCompaction() {
+        if (compaction.joinable()) {
+            compaction.join();
+        }
+    }
+
+    // Rebuilds target from the newest snapshot and every segment up to and
+    // including lastSegment.
+    static void replay(Container& target, const std::string& base, uint64_t lastSegment = UINT64_MAX) {
+        uint64_t first = latestSnapshot(base);
+
+        if (std::filesystem::exists(snapshotPath(base, first))) {
+            target.deserializeBinary(snapshotPath(base, first));
+        }
+
+        uint64_t last = std::min(lastSegment, latestSegment(base));
+
+        if (last == NONE) {
+            return;
+        }
+
+        for (uint64_t segment = first; segment <= last; ++segment) {
+            replaySegment(target, segmentPath(base, segment));
+        }
+    }
+
+    static std::string snapshotPath(const std::string& base, uint64_t generation) {
+        return base + ".snapshot." + std::to_string(generation);
+    }
+
+    static std::string segmentPath(const std::string& base, uint64_t generation) {
+        return base + ".journal." + std::to_string(generation);
+    }
+
+private:
+    static constexpr char PUSH = 1;
+    static constexpr char POP = 2;
+    static constexpr uint64_t NONE = UINT64_MAX;
+
+    std::string base;
+    JournalOptions options;
+    int fd;
+    BufferWriter pending;
+    size_t pendingRecords;
+    uint64_t generation;
+    std::thread compaction;
+
+    void recorded() {
+        if (++pendingRecords >= options.batchSize) {
+            commit();
+        }
+    }
+
+    void openSegment() {
+        fd = ::open(segmentPath(base, generation).c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+
+        if (fd < 0) {
+            std::cerr << "Unable to open the journal." << std::endl;
+        }
+    }
+
+    static void syncFile(const std::string& path) {
+        int file = ::open(path.c_str(), O_RDONLY);
+
+        if (file >= 0) {
+            ::fsync(file);
+            ::close(file);
+        }
+    }
+
+    // Highest generation among "<base><infix><g>" files, or NONE.
+    static uint64_t latestGeneration(const std::string& base, const std::string& infix) {
+        std::filesystem::path basePath(base);
+        std::filesystem::path directory = basePath.has_parent_path() ? basePath.parent_path() : ".";
+        std::string prefix = basePath.filename().string() + infix;
+        uint64_t latest = NONE;
+        std::error_code error;
+
+        for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+            std::string name = entry.path().filename().string();
+
+            if (name.compare(0, prefix.size(), prefix) != 0 || name.size() == prefix.size()
+                || name.find_first_not_of("0123456789", prefix.size()) != std::string::npos) {
+                continue;
+            }
+
+            uint64_t found = std::stoull(name.substr(prefix.size()));
+            latest = latest == NONE ? found : std::max(latest, found);
+        }
+
+        return latest;
+    }
+
+    static uint64_t latestSnapshot(const std::string& base) {
+        uint64_t latest = latestGeneration(base, ".snapshot.");
+        return latest == NONE ? 0 : latest;
+    }
+
+    static uint64_t latestSegment(const std::string& base) {
+        return latestGeneration(base, ".journal.");
+    }
+
+    // A record cut short by a crash ends the replay of its segment.
+    static void replaySegment(Container& target, const std::string& path) {
+        BinaryReader reader(path);
+        char op;
+        T value;
+
+        while (reader.is_open() && reader.read(&op, 1)) {
+            if (op == PUSH && reader.readValue(value)) {
+                target.push(value);
+            }
+            else if (op == POP) {
+                target.pop();
+            }
+            else {
+                break;
+            }
+        }
+    }
+};
@@ -0,0 +1,219 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Contiguous storage for the keys of one table that are too long to be kept in
+// their slot. Keys are appended and addressed by offset, so growing the arena
+// does not invalidate any slot. Removed keys only count as garbage until the
+// owner compacts the arena by relocating its live keys into a new one.
+class KeyArena {
+public:
+    KeyArena() : garbageBytes(0) {}
+
+    uint64_t append(std::string_view key) {
+        uint64_t offset = bytes.size();
+        bytes.insert(bytes.end(), key.begin(), key.end());
+        return offset;
+    }
+
+    // Grows the arena by length bytes and returns the offset of the new space,
+    // which threads may then fill in disjoint parts with write().
+    uint64_t extend(size_t length) {
+        uint64_t offset = bytes.size();
+        bytes.resize(bytes.size() + length);
+        return offset;
+    }
+
+    void write(uint64_t offset, std::string_view key) {
+        std::memcpy(bytes.data() + offset, key.data(), key.size());
+    }
+
+    std::string_view view(uint64_t offset, size_t length) const {
+        return std::string_view(bytes.data() + offset, length);
+    }
+
+    void release(size_t length) {
+        garbageBytes += length;
+    }
+
+    void reserve(size_t length) {
+        bytes.reserve(length);
+    }
+
+    size_t size() const {
+        return bytes.size();
+    }
+
+    size_t capacity() const {
+        return bytes.capacity();
+    }
+
+    size_t garbage() const {
+        return garbageBytes;
+    }
+
+private:
+    std::vector<char> bytes;
+    size_t garbageBytes;
+};
+
+// How a HashTable slot holds its key. In general that is the key itself, and
+// its hash is recomputed whenever it is needed.
+template <typename Key>
+class KeySlot {
+public:
+    using View = const Key&;
+
+    static size_t arenaBytes(const Key&) {
+        return 0;
+    }
+
+    size_t hash() const {
+        return std::hash<Key>{}(key);
+    }
+
+    View view(const KeyArena&) const {
+        return key;
+    }
+
+    bool matches(size_t, const Key& other, const KeyArena&) const {
+        return key == other;
+    }
+
+    void assign(const Key& other, size_t, KeyArena&) {
+        key = other;
+    }
+
+    // Like assign, for keys whose arena space was set aside with extend() and
+    // starts at cursor.
+    void assignAt(Key& other, size_t, KeyArena&, uint64_t&) {
+        key = std::move(other);
+    }
+
+    void release(KeyArena&) {}
+
+    void relocate(const KeyArena&, KeyArena&) {}
+
+private:
+    Key key;
+};
+
+// String keys of up to INLINE_BYTES bytes are stored in the slot itself, longer
+// ones in the table's arena, and the full hash is cached next to them: probes
+// compare hashes before bytes, and rehashing never reads a key. A slot takes 24
+// bytes where a std::string alone takes 32, and a long key costs its length in
+// the arena instead of a heap block.
+template <>
+class KeySlot<std::string> {
+public:
+    using View = std::string_view;
+
+    static constexpr size_t INLINE_BYTES = 15;
+
+    KeySlot() : cached(0) {
+        std::memset(bytes, 0, sizeof(bytes));
+    }
+
+    static size_t arenaBytes(std::string_view key) {
+        return key.size() > INLINE_BYTES ? key.size() : 0;
+    }
+
+    size_t hash() const {
+        return cached;
+    }
+
+    View view(const KeyArena& arena) const {
+        if (isInline()) {
+            return std::string_view(bytes, tag());
+        }
+
+        return arena.view(offset(), length());
+    }
+
+    bool matches(size_t hash, std::string_view other, const KeyArena& arena) const {
+        return cached == hash && view(arena) == other;
+    }
+
+    void assign(std::string_view key, size_t hash, KeyArena& arena) {
+        if (key.size() <= INLINE_BYTES) {
+            setInline(key);
+        }
+        else {
+            setOutline(arena.append(key), key.size());
+        }
+
+        cached = hash;
+    }
+
+    void assignAt(std::string_view key, size_t hash, KeyArena& arena, uint64_t& cursor) {
+        if (key.size() <= INLINE_BYTES) {
+            setInline(key);
+        }
+        else {
+            arena.write(cursor, key);
+            setOutline(cursor, key.size());
+            cursor += key.size();
+        }
+
+        cached = hash;
+    }
+
+    void release(KeyArena& arena) {
+        if (!isInline()) {
+            arena.release(length());
+        }
+    }
+
+    void relocate(const KeyArena& from, KeyArena& to) {
+        if (!isInline()) {
+            setOutline(to.append(from.view(offset(), length())), length());
+        }
+    }
+
+private:
+    static constexpr uint8_t OUTLINE = 0xFF;
+
+    // Inline: the key's bytes, with its length in the last byte. Outline: the
+    // arena offset, the length (keys are below 4 GiB) and OUTLINE last.
+    char bytes[INLINE_BYTES + 1];
+    size_t cached;
+
+    uint8_t tag() const {
+        return static_cast<uint8_t>(bytes[INLINE_BYTES]);
+    }
+
+    bool isInline() const {
+        return tag() != OUTLINE;
+    }
+
+    uint64_t offset() const {
+        uint64_t value;
+        std::memcpy(&value, bytes, sizeof(value));
+        return value;
+    }
+
+    uint32_t length() const {
+        uint32_t value;
+        std::memcpy(&value, bytes + sizeof(uint64_t), sizeof(value));
+        return value;
+    }
+
+    void setInline(std::string_view key) {
+        std::memcpy(bytes, key.data(), key.size());
+        bytes[INLINE_BYTES] = static_cast<char>(key.size());
+    }
+
+    void setOutline(uint64_t offset, size_t length) {
+        uint32_t shortLength = static_cast<uint32_t>(length);
+        std::memcpy(bytes, &offset, sizeof(offset));
+        std::memcpy(bytes + sizeof(uint64_t), &shortLength, sizeof(shortLength));
+        bytes[INLINE_BYTES] = static_cast<char>(OUTLINE);
+    }
+};
@@ -1,147 +1,200 @@
-#include <benchmark/benchmark.h>
 #include <gtest/gtest.h>
 #include <iostream>
 #include <sstream>
 #include <fstream>
+#include <numeric>
+#include <array>
+#include <atomic>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <new>
+#include <random>
+#include <thread>
+#include "list.h"
 
-template <typename T>
-struct Node {
-    T data;
-    Node* next;
+TEST(ListTest, PushAndPrint) {
+    List<int> myList;
 
-    Node(const T& value) : data(value), next(nullptr) {}
-};
+    myList.push(1);
+    myList.push(2);
 
-template <typename T>
-class List {
-private:
-    Node<T>* head;
+    std::string textData = myList.serializeText();
+    std::cout << "Text Serialization: " << textData << std::endl;
 
-public:
-    List() : head(nullptr) {}
+    myList.deserializeText(textData);
+    std::cout << "After Text Deserialization: ";
+    myList.print();
 
-    void push(const T& value) {
-        Node<T>* newNode = new Node<T>(value);
+    myList.serializeBinary("binary_data_list.bin");
 
-        if (head == nullptr) {
-            head = newNode;
-        }
-        else {
-            Node<T>* current = head;
-            while (current->next != nullptr) {
-                current = current->next;
-            }
-            current->next = newNode;
-        }
-    }
+    List<int> newList;
 
-    std::string serializeText() const {
-        std::ostringstream oss;
-        Node<T>* current = head;
+    newList.deserializeBinary("binary_data_list.bin");
 
-        while (current != nullptr) {
-            oss << current->data << " ";
-            current = current->next;
-        }
+    std::cout << "After Binary Deserialization: ";
+    newList.print();
+}
 
-        return oss.str();
-    }
+TEST(ListTest, PrintEmptyList) {
+    List<int> myList;
+    std::cout << "Empty List: ";
+    myList.print();
+}
 
-    void deserializeText(const std::string& data) {
+TEST(ListTest, MappedView) {
+    List<int> myList;
+    myList.push(1);
+    myList.push(2);
+    myList.push(3);
 
-        std::istringstream iss(data);
-        T value;
+    myList.serializeBinary("binary_data_list.bin");
 
-        while (iss >> value) {
-            push(value);
-        }
-    }
+    ListView<int> view("binary_data_list.bin");
 
-    void serializeBinary(const std::string& filename) const {
-        std::ofstream ofs(filename, std::ios::binary);
+    ASSERT_EQ(view.size(), 3u);
+    EXPECT_EQ(view[1], 2);
+    EXPECT_EQ(std::accumulate(view.begin(), view.end(), 0), 6);
+}
 
-        if (ofs.is_open()) {
-            Node<T>* current = head;
+TEST(ListTest, MappedViewMissingFile) {
+    ListView<int> view("missing_list.bin");
 
-            while (current != nullptr) {
-                ofs.write(reinterpret_cast<char*>(&current->data), sizeof(T));
-                current = current->next;
-            }
+    EXPECT_FALSE(view.is_open());
+    EXPECT_TRUE(view.isEmpty());
+}
 
-            ofs.close();
-        }
-        else {
-            std::cerr << "Unable to open the file for binary serialization." << std::endl;
-        }
-    }
+TEST(ListTest, SortUniqueMergeReverse) {
+    List<int> myList;
 
-    void deserializeBinary(const std::string& filename) {
+    myList.sort();
+    myList.reverse();
+    EXPECT_EQ(myList.serializeText(), "");
 
-        std::ifstream ifs(filename, std::ios::binary);
+    for (int value : {3, 1, 2, 3, 1}) {
+        myList.push(value);
+    }
 
-        if (ifs.is_open()) {
-            T value;
+    myList.sort();
+    EXPECT_EQ(myList.serializeText(), "1 1 2 3 3 ");
+    EXPECT_EQ(myList.unique(), 2u);
+    EXPECT_EQ(myList.serializeText(), "1 2 3 ");
+
+    List<int> other;
+    other.push(0);
+    other.push(2);
+    other.push(5);
+    myList.merge(other);
+    myList.push(6);
+    EXPECT_EQ(myList.serializeText(), "0 1 2 2 3 5 6 ");
+    EXPECT_EQ(other.serializeText(), "");
+
+    myList.reverse();
+    myList.push(-1);
+    EXPECT_EQ(myList.serializeText(), "6 5 3 2 2 1 0 -1 ");
+}
 
-            while (ifs.read(reinterpret_cast<char*>(&value), sizeof(T))) {
-                push(value);
-            }
+TEST(ListTest, ParallelSortIsStable) {
+    List<int> myList;
+    ThreadPool pool(4);
+    std::mt19937 random(5);
 
-            ifs.close();
-        }
-        else {
-            std::cerr << "Unable to open the file for binary deserialization." << std::endl;
-        }
+    for (int i = 0; i < 300000; ++i) {
+        myList.push(static_cast<int>(random() % 1000) * 1000000 + i);
     }
 
-    void print() const {
-        Node<T>* current = head;
-        while (current != nullptr) {
-            std::cout << current->data << " ";
-            current = current->next;
-        }
-        std::cout << std::endl;
+    // Ordered by the key in the high digits only; the low digits record the
+    // original position, which must stay ascending within a key.
+    myList.sort([](int a, int b) { return a / 1000000 < b / 1000000; }, pool);
+
+    int previous = -1;
+    bool ordered = true;
+    size_t count = 0;
+
+    myList.visit([&](int value) {
+        ordered = ordered && (previous < 0 || previous / 1000000 < value / 1000000
+            || (previous / 1000000 == value / 1000000 && previous < value));
+        previous = value;
+        ++count;
+    });
+
+    EXPECT_TRUE(ordered);
+    EXPECT_EQ(count, 300000u);
+}
+
+TEST(ListTest, OrderedListLookup) {
+    OrderedList<int> myList;
+
+    EXPECT_EQ(myList.find(1), nullptr);
+    EXPECT_EQ(myList.lowerBound(1), myList.end());
+
+    for (int value : {50, 10, 40, 20, 30, 20, 60}) {
+        myList.insert(value);
     }
-};
 
-TEST(ListTest, PushAndPrint) {
-    List<int> myList;
+    EXPECT_EQ(myList.size(), 7u);
+    EXPECT_EQ(myList.serializeText(), "10 20 20 30 40 50 60 ");
+    ASSERT_NE(myList.find(40), nullptr);
+    EXPECT_EQ(*myList.find(40), 40);
+    EXPECT_EQ(myList.find(35), nullptr);
+    EXPECT_EQ(*myList.lowerBound(35), 40);
+    EXPECT_EQ(myList.lowerBound(61), myList.end());
 
-    myList.push(1);
-    myList.push(2);
+    std::string scanned;
 
-    std::string textData = myList.serializeText();
-    std::cout << "Text Serialization: " << textData << std::endl;
+    for (int value : myList.range(20, 50)) {
+        scanned += std::to_string(value) + " ";
+    }
 
-    myList.deserializeText(textData);
-    std::cout << "After Text Deserialization: ";
-    myList.print();
+    EXPECT_EQ(scanned, "20 20 30 40 ");
+}
 
-    myList.serializeBinary("binary_data_list.bin");
+TEST(ListTest, OrderedListSerialize) {
+    OrderedList<int64_t> myList;
+    std::mt19937_64 random(7);
 
-    List<int> newList;
+    for (int i = 0; i < 10000; ++i) {
+        myList.insert(random() % 100000);
+    }
+
+    EXPECT_TRUE(std::is_sorted(myList.begin(), myList.end()));
 
+    myList.serializeBinary("binary_data_list.bin", BinaryEncoding::DeltaVarint);
+
+    OrderedList<int64_t> newList;
     newList.deserializeBinary("binary_data_list.bin");
+    EXPECT_EQ(newList.size(), 10000u);
+    EXPECT_TRUE(std::equal(myList.begin(), myList.end(), newList.begin()));
 
-    std::cout << "After Binary Deserialization: ";
-    newList.print();
+    OrderedList<int64_t> textList;
+    textList.deserializeText(myList.serializeText());
+    EXPECT_TRUE(std::equal(myList.begin(), myList.end(), textList.begin()));
 }
 
-TEST(ListTest, PrintEmptyList) {
-    List<int> myList;
-    std::cout << "Empty List: ";
-    myList.print();
-}
+TEST(ListTest, OrderedListConcurrentReaders) {
+    OrderedList<int> myList;
+    std::atomic<bool> done(false);
+    std::atomic<bool> ordered(true);
 
-static void BM_Push(benchmark::State& state) {
-    List<int> myList;
+    std::thread reader([&]() {
+        while (!done.load()) {
+            ordered = ordered && std::is_sorted(myList.begin(), myList.end());
+            myList.find(500);
+        }
+    });
 
-    for (auto _ : state) {
-        myList.push(42); 
+    std::mt19937 random(11);
+
+    for (int i = 0; i < 100000; ++i) {
+        myList.insert(random() % 1000);
     }
-}
-BENCHMARK(BM_Push);
 
-BENCHMARK_MAIN();
+    done.store(true);
+    reader.join();
+
+    EXPECT_TRUE(ordered.load());
+    EXPECT_EQ(std::distance(myList.begin(), myList.end()), 100000);
+}
 
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,688 @@
+#pragma once
+
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <numeric>
+#include <array>
+#include <atomic>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <new>
+#include <random>
+#include <thread>
+#include "node.h"
+#include "binaryIO.h"
+#include "asyncWriter.h"
+#include "integerCodec.h"
+#include "textIO.h"
+#include "mappedView.h"
+#include "chainAlgorithms.h"
+#include "instrumentation.h"
+
+template <typename T>
+class List {
+private:
+    Node<T>* head;
+    Node<T>* tail;
+
+public:
+    // Allocation and operation counts of every list of this type, all zero
+    // unless built with CONTAINER_INSTRUMENTATION; see instrumentation.h.
+    using Counters = CountersFor<List>;
+
+    static CounterSnapshot counters() {
+        return Counters::snapshot();
+    }
+
+    List() : head(nullptr), tail(nullptr) {}
+
+    List(const List&) = delete;
+    List& operator=(const List&) = delete;
+
+    ~List() {
+        clear();
+    }
+
+    void clear() {
+        while (head != nullptr) {
+            Node<T>* next = head->next;
+            delete head;
+            Counters::released(sizeof(Node<T>));
+            head = next;
+        }
+
+        tail = nullptr;
+    }
+
+    void push(const T& value) {
+        Node<T>* newNode = new Node<T>(value);
+        Counters::allocated(sizeof(Node<T>));
+        Counters::operation();
+
+        if (head == nullptr) {
+            head = tail = newNode;
+        }
+        else {
+            tail->next = newNode;
+            tail = newNode;
+        }
+    }
+
+    // Linear search from the head; nullptr when no element equals value.
+    const T* find(const T& value) const {
+        Counters::operation();
+
+        for (Node<T>* current = head; current != nullptr; current = current->next) {
+            if (current->data == value) {
+                return &current->data;
+            }
+        }
+
+        return nullptr;
+    }
+
+    // Stable merge sort that relinks the nodes; lists of PARALLEL_SORT_THRESHOLD
+    // elements or more are sorted on pool.
+    template <typename Less = std::less<T>>
+    void sort(const Less& less = Less(), ThreadPool& pool = ThreadPool::shared()) {
+        head = parallelSortChain(head, chainLength(head), less, pool);
+        tail = chainTail(head);
+    }
+
+    // Removes every element equal to the one before it and returns how many
+    // were removed.
+    size_t unique() {
+        size_t removed = uniqueChain(head);
+        Counters::released(removed * sizeof(Node<T>), removed);
+        Counters::operation(removed);
+        tail = chainTail(head);
+        return removed;
+    }
+
+    // Moves the nodes of other, which must be sorted like this list, into
+    // their sorted places here; other is left empty.
+    template <typename Less = std::less<T>>
+    void merge(List<T>& other, const Less& less = Less()) {
+        if (other.head == nullptr) {
+            return;
+        }
+
+        if (head == nullptr || !less(other.tail->data, tail->data)) {
+            tail = other.tail;
+        }
+
+        head = mergeChains(head, other.head, less);
+        other.head = other.tail = nullptr;
+    }
+
+    void reverse() {
+        tail = head;
+        head = reverseChain(head);
+    }
+
+    template <typename Visitor>
+    void visit(Visitor&& visitor) const {
+        for (Node<T>* current = head; current != nullptr; current = current->next) {
+            visitor(current->data);
+        }
+    }
+
+    std::string serializeText() const {
+        std::string text;
+        Node<T>* current = head;
+
+        while (current != nullptr) {
+            appendText(text, current->data);
+            text += ' ';
+            current = current->next;
+        }
+
+        Counters::serialized(text.size());
+        return text;
+    }
+
+    bool serializeText(int fd) const {
+        TextWriter writer(fd);
+        Node<T>* current = head;
+
+        while (current != nullptr) {
+            writer.write(current->data);
+            writer.write(" ");
+            current = current->next;
+        }
+
+        writer.flush();
+        Counters::serialized(writer.bytesWritten());
+        return writer.good();
+    }
+
+    void deserializeText(const std::string& data) {
+
+        TextReader reader(data);
+        T value;
+
+        while (reader.read(value)) {
+            push(value);
+        }
+    }
+
+    // BinaryEncoding::DeltaVarint compresses integral payloads; other types are
+    // always written raw.
+    void serializeBinary(const std::string& filename, BinaryEncoding encoding = BinaryEncoding::Raw) const {
+        BinaryWriter writer(filename);
+
+        if constexpr (std::is_integral_v<T> && sizeof(T) <= 8) {
+            if (writer.is_open() && encoding == BinaryEncoding::DeltaVarint) {
+                DeltaVarintEncoder<T> encoder;
+
+                for (Node<T>* current = head; current != nullptr; current = current->next) {
+                    encoder.push(current->data);
+                }
+
+                writer.writeHeader(sizeof(T), encoder.size(), BinaryEncoding::DeltaVarint);
+                encoder.write(writer);
+                Counters::serialized(writer.bytesWritten());
+                writer.close();
+                return;
+            }
+        }
+
+        if (writer.is_open()) {
+            writer.writeHeader(sizeof(T), 0);
+            Node<T>* current = head;
+            uint64_t count = 0;
+
+            while (current != nullptr) {
+                writer.writeValue(current->data);
+                current = current->next;
+                ++count;
+            }
+
+            writer.patchCount(count);
+            Counters::serialized(writer.bytesWritten());
+            writer.close();
+        }
+        else {
+            std::cerr << "Unable to open the file for binary serialization." << std::endl;
+        }
+    }
+
+    // Encodes the dump into the writer's buffers and returns once the last byte
+    // is queued; the future reports when the file is complete.
+    std::future<bool> serializeBinaryAsync(const std::string& filename, AsyncWriter& writer = AsyncWriter::shared()) const {
+        AsyncWriter::Snapshot snapshot = writer.begin(filename);
+        snapshot.writeHeader(sizeof(T), 0);
+        Node<T>* current = head;
+        uint64_t count = 0;
+
+        while (current != nullptr) {
+            snapshot.writeValue(current->data);
+            current = current->next;
+            ++count;
+        }
+
+        snapshot.patchCount(count);
+        return snapshot.finish();
+    }
+
+    void deserializeBinary(const std::string& filename) {
+
+        BinaryReader reader(filename);
+
+        if (reader.is_open()) {
+            BinaryHeader header;
+
+            if (!reader.read(&header, sizeof(header)) || !header.isValid(sizeof(T))) {
+                std::cerr << "Invalid binary header." << std::endl;
+                return;
+            }
+
+            if constexpr (std::is_integral_v<T> && sizeof(T) <= 8) {
+                if (header.encoding == BinaryEncoding::DeltaVarint) {
+                    DeltaVarintDecoder<T> decoder;
+                    T values[256];
+                    size_t decoded = 0;
+
+                    if (!decoder.read(reader, header.count)) {
+                        std::cerr << "Invalid compressed payload." << std::endl;
+                        return;
+                    }
+
+                    while ((decoded = decoder.next(values, 256)) > 0) {
+                        for (size_t i = 0; i < decoded; ++i) {
+                            push(values[i]);
+                        }
+                    }
+
+                    reader.close();
+                    return;
+                }
+            }
+
+            if (header.encoding != BinaryEncoding::Raw) {
+                std::cerr << "Invalid binary header." << std::endl;
+                return;
+            }
+
+            T value;
+
+            for (uint64_t i = 0; i < header.count && reader.readValue(value); ++i) {
+                push(value);
+            }
+
+            reader.close();
+        }
+        else {
+            std::cerr << "Unable to open the file for binary deserialization." << std::endl;
+        }
+    }
+
+    void print() const {
+        Node<T>* current = head;
+        while (current != nullptr) {
+            std::cout << current->data << " ";
+            current = current->next;
+        }
+        std::cout << std::endl;
+    }
+};
+
+// Elements in the order they were pushed, as written by List::serializeBinary.
+template <typename T>
+class ListView : public MappedView<T> {
+public:
+    using MappedView<T>::MappedView;
+};
+
+// List kept in ascending order with a skip-list index over its nodes. Level 0
+// links every node in order, like List; each node also has a tower of links that
+// skip ahead, so insert, find and lowerBound take O(log n) expected steps. Equal
+// elements keep their insertion order, and appending an element no smaller than
+// the last one skips the search entirely.
+//
+// One thread inserts while any number of threads search and scan without locks:
+// a node is filled in before it is linked with release stores, and nodes are
+// only freed with the list.
+template <typename T>
+class OrderedList {
+public:
+    static constexpr size_t MAX_LEVEL = 24;
+
+    // Allocation and operation counts of every ordered list of this type, all
+    // zero unless built with CONTAINER_INSTRUMENTATION; see instrumentation.h.
+    using Counters = CountersFor<OrderedList>;
+
+    static CounterSnapshot counters() {
+        return Counters::snapshot();
+    }
+
+private:
+    struct SkipNode;
+    using Link = std::atomic<SkipNode*>;
+
+    struct SkipNode {
+        T data;
+        size_t height;
+
+        SkipNode(const T& value, size_t height) : data(value), height(height) {}
+
+        // The tower of height links is allocated right after the node.
+        Link* links() {
+            return reinterpret_cast<Link*>(this + 1);
+        }
+
+        static SkipNode* create(const T& value, size_t height) {
+            void* memory = ::operator new(sizeof(SkipNode) + height * sizeof(Link));
+            Counters::allocated(sizeof(SkipNode) + height * sizeof(Link));
+            SkipNode* node = new (memory) SkipNode(value, height);
+
+            for (size_t level = 0; level < height; ++level) {
+                new (node->links() + level) Link(nullptr);
+            }
+
+            return node;
+        }
+
+        static void destroy(SkipNode* node) {
+            Counters::released(sizeof(SkipNode) + node->height * sizeof(Link));
+            node->~SkipNode();
+            ::operator delete(node);
+        }
+    };
+
+    static_assert(alignof(SkipNode) >= alignof(Link), "the link tower would be misaligned");
+
+    std::array<Link, MAX_LEVEL> head;
+    std::array<Link*, MAX_LEVEL> tails;
+    SkipNode* last;
+    std::atomic<size_t> levels;
+    std::atomic<size_t> count;
+    uint64_t randomState;
+
+    size_t randomHeight() {
+        randomState ^= randomState << 13;
+        randomState ^= randomState >> 7;
+        randomState ^= randomState << 17;
+
+        // Each extra level is kept with probability 1/4.
+        size_t height = 1 + __builtin_ctzll(randomState | (uint64_t(1) << 63)) / 2;
+        return std::min(height, MAX_LEVEL);
+    }
+
+    // First node whose element is not less than value (or, with after set, is
+    // greater than value); fills preds with the link arrays that lead to it.
+    SkipNode* search(const T& value, bool after, Link** preds) const {
+        Link* links = const_cast<Link*>(head.data());
+
+        for (size_t level = levels.load(std::memory_order_acquire); level-- > 0;) {
+            SkipNode* next = links[level].load(std::memory_order_acquire);
+
+            while (next != nullptr && (after ? !(value < next->data) : next->data < value)) {
+                links = next->links();
+                next = links[level].load(std::memory_order_acquire);
+            }
+
+            if (preds != nullptr) {
+                preds[level] = links;
+            }
+        }
+
+        return links[0].load(std::memory_order_acquire);
+    }
+
+public:
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        explicit Iterator(SkipNode* node = nullptr) : node(node) {}
+
+        reference operator*() const {
+            return node->data;
+        }
+
+        pointer operator->() const {
+            return &node->data;
+        }
+
+        Iterator& operator++() {
+            node = node->links()[0].load(std::memory_order_acquire);
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            Iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        bool operator==(const Iterator& other) const {
+            return node == other.node;
+        }
+
+        bool operator!=(const Iterator& other) const {
+            return node != other.node;
+        }
+
+    private:
+        SkipNode* node;
+    };
+
+    class Range {
+    public:
+        Range(Iterator first, Iterator last) : first(first), last(last) {}
+
+        Iterator begin() const {
+            return first;
+        }
+
+        Iterator end() const {
+            return last;
+        }
+
+    private:
+        Iterator first;
+        Iterator last;
+    };
+
+    OrderedList() : last(nullptr), levels(1), count(0), randomState(0x9E3779B97F4A7C15ULL) {
+        for (size_t level = 0; level < MAX_LEVEL; ++level) {
+            head[level].store(nullptr, std::memory_order_relaxed);
+            tails[level] = head.data();
+        }
+    }
+
+    OrderedList(const OrderedList&) = delete;
+    OrderedList& operator=(const OrderedList&) = delete;
+
+    ~OrderedList() {
+        SkipNode* current = head[0].load(std::memory_order_relaxed);
+
+        while (current != nullptr) {
+            SkipNode* next = current->links()[0].load(std::memory_order_relaxed);
+            SkipNode::destroy(current);
+            current = next;
+        }
+    }
+
+    void insert(const T& value) {
+        Counters::operation();
+        size_t height = randomHeight();
+        std::array<Link*, MAX_LEVEL> preds;
+        bool appending = last == nullptr || !(value < last->data);
+
+        if (appending) {
+            preds = tails;
+        }
+        else {
+            search(value, true, preds.data());
+        }
+
+        size_t current = levels.load(std::memory_order_relaxed);
+
+        for (size_t level = current; level < height; ++level) {
+            preds[level] = head.data();
+        }
+
+        SkipNode* node = SkipNode::create(value, height);
+
+        for (size_t level = 0; level < height; ++level) {
+            node->links()[level].store(preds[level][level].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+
+        for (size_t level = 0; level < height; ++level) {
+            preds[level][level].store(node, std::memory_order_release);
+        }
+
+        if (height > current) {
+            levels.store(height, std::memory_order_release);
+        }
+
+        if (appending) {
+            for (size_t level = 0; level < height; ++level) {
+                tails[level] = node->links();
+            }
+
+            last = node;
+        }
+        else {
+            for (size_t level = 0; level < height; ++level) {
+                if (node->links()[level].load(std::memory_order_relaxed) == nullptr) {
+                    tails[level] = node->links();
+                }
+            }
+        }
+
+        count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // First element not less than value, or end().
+    Iterator lowerBound(const T& value) const {
+        return Iterator(search(value, false, nullptr));
+    }
+
+    // An element equal to value, or nullptr.
+    const T* find(const T& value) const {
+        Counters::operation();
+        SkipNode* node = search(value, false, nullptr);
+
+        if (node != nullptr && !(value < node->data)) {
+            return &node->data;
+        }
+
+        return nullptr;
+    }
+
+    // Elements in [low, high), in order.
+    Range range(const T& low, const T& high) const {
+        return Range(lowerBound(low), lowerBound(high));
+    }
+
+    Iterator begin() const {
+        return Iterator(head[0].load(std::memory_order_acquire));
+    }
+
+    Iterator end() const {
+        return Iterator();
+    }
+
+    bool isEmpty() const {
+        return head[0].load(std::memory_order_acquire) == nullptr;
+    }
+
+    size_t size() const {
+        return count.load(std::memory_order_relaxed);
+    }
+
+    std::string serializeText() const {
+        std::string text;
+
+        for (const T& value : *this) {
+            appendText(text, value);
+            text += ' ';
+        }
+
+        Counters::serialized(text.size());
+        return text;
+    }
+
+    bool serializeText(int fd) const {
+        TextWriter writer(fd);
+
+        for (const T& value : *this) {
+            writer.write(value);
+            writer.write(" ");
+        }
+
+        writer.flush();
+        Counters::serialized(writer.bytesWritten());
+        return writer.good();
+    }
+
+    void deserializeText(const std::string& data) {
+        TextReader reader(data);
+        T value;
+
+        while (reader.read(value)) {
+            insert(value);
+        }
+    }
+
+    // Same layout as List::serializeBinary. The elements are sorted, so
+    // BinaryEncoding::DeltaVarint stores most integral keys in a byte or two.
+    void serializeBinary(const std::string& filename, BinaryEncoding encoding = BinaryEncoding::Raw) const {
+        BinaryWriter writer(filename);
+
+        if constexpr (std::is_integral_v<T> && sizeof(T) <= 8) {
+            if (writer.is_open() && encoding == BinaryEncoding::DeltaVarint) {
+                DeltaVarintEncoder<T> encoder;
+
+                for (const T& value : *this) {
+                    encoder.push(value);
+                }
+
+                writer.writeHeader(sizeof(T), encoder.size(), BinaryEncoding::DeltaVarint);
+                encoder.write(writer);
+                Counters::serialized(writer.bytesWritten());
+                writer.close();
+                return;
+            }
+        }
+
+        if (writer.is_open()) {
+            writer.writeHeader(sizeof(T), 0);
+            uint64_t written = 0;
+
+            for (const T& value : *this) {
+                writer.writeValue(value);
+                ++written;
+            }
+
+            writer.patchCount(written);
+            Counters::serialized(writer.bytesWritten());
+            writer.close();
+        }
+        else {
+            std::cerr << "Unable to open the file for binary serialization." << std::endl;
+        }
+    }
+
+    // Dumps of an OrderedList are sorted, so loading one into an empty list
+    // only ever appends.
+    void deserializeBinary(const std::string& filename) {
+        BinaryReader reader(filename);
+
+        if (reader.is_open()) {
+            BinaryHeader header;
+
+            if (!reader.read(&header, sizeof(header)) || !header.isValid(sizeof(T))) {
+                std::cerr << "Invalid binary header." << std::endl;
+                return;
+            }
+
+            if constexpr (std::is_integral_v<T> && sizeof(T) <= 8) {
+                if (header.encoding == BinaryEncoding::DeltaVarint) {
+                    DeltaVarintDecoder<T> decoder;
+                    T values[256];
+                    size_t decoded = 0;
+
+                    if (!decoder.read(reader, header.count)) {
+                        std::cerr << "Invalid compressed payload." << std::endl;
+                        return;
+                    }
+
+                    while ((decoded = decoder.next(values, 256)) > 0) {
+                        for (size_t i = 0; i < decoded; ++i) {
+                            insert(values[i]);
+                        }
+                    }
+
+                    reader.close();
+                    return;
+                }
+            }
+
+            if (header.encoding != BinaryEncoding::Raw) {
+                std::cerr << "Invalid binary header." << std::endl;
+                return;
+            }
+
+            T value;
+
+            for (uint64_t i = 0; i < header.count && reader.readValue(value); ++i) {
+                insert(value);
+            }
+
+            reader.close();
+        }
+        else {
+            std::cerr << "Unable to open the file for binary deserialization." << std::endl;
+        }
+    }
+};
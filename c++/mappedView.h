@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "binaryIO.h"
+
+// Read-only view of a binary dump mapped straight into memory: opening it costs
+// one mmap, and elements are read in place without building any nodes.
+template <typename T>
+class MappedView {
+    static_assert(std::is_trivially_copyable_v<T>, "mapped views require a trivially copyable type");
+    static_assert(sizeof(BinaryHeader) % alignof(T) == 0, "payload would be misaligned for this type");
+
+public:
+    using value_type = T;
+    using const_iterator = const T*;
+
+    explicit MappedView(const std::string& filename) : mapping(nullptr), length(0), elements(nullptr), count(0) {
+        int fd = ::open(filename.c_str(), O_RDONLY);
+
+        if (fd < 0) {
+            std::cerr << "Unable to open the file for mapping." << std::endl;
+            return;
+        }
+
+        struct stat info;
+
+        if (::fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= sizeof(BinaryHeader)) {
+            length = info.st_size;
+            mapping = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+
+            if (mapping == MAP_FAILED) {
+                mapping = nullptr;
+                length = 0;
+            }
+        }
+
+        ::close(fd);
+
+        const BinaryHeader* header = static_cast<const BinaryHeader*>(mapping);
+
+        if (!header || !header->isValid(sizeof(T)) || header->encoding != BinaryEncoding::Raw
+            || header->count > (length - sizeof(BinaryHeader)) / sizeof(T)) {
+            std::cerr << "Invalid binary header." << std::endl;
+            unmap();
+            return;
+        }
+
+        ::madvise(mapping, length, MADV_SEQUENTIAL);
+        elements = reinterpret_cast<const T*>(static_cast<const char*>(mapping) + sizeof(BinaryHeader));
+        count = header->count;
+    }
+
+    MappedView(const MappedView&) = delete;
+    MappedView& operator=(const MappedView&) = delete;
+
+    MappedView(MappedView&& other) noexcept
+        : mapping(other.mapping), length(other.length), elements(other.elements), count(other.count) {
+        other.mapping = nullptr;
+        other.length = 0;
+        other.elements = nullptr;
+        other.count = 0;
+    }
+
+    ~MappedView() {
+        unmap();
+    }
+
+    bool is_open() const {
+        return mapping != nullptr;
+    }
+
+    bool isEmpty() const {
+        return count == 0;
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    const T& operator[](size_t index) const {
+        return elements[index];
+    }
+
+    const T* data() const {
+        return elements;
+    }
+
+    const_iterator begin() const {
+        return elements;
+    }
+
+    const_iterator end() const {
+        return elements + count;
+    }
+
+private:
+    void* mapping;
+    size_t length;
+    const T* elements;
+    size_t count;
+
+    void unmap() {
+        if (mapping) {
+            ::munmap(mapping, length);
+        }
+
+        mapping = nullptr;
+        length = 0;
+        elements = nullptr;
+        count = 0;
+    }
+};
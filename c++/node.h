@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <new>
+
+// Singly linked node shared by Stack, Queue and List.
+template <typename T>
+struct Node {
+    T data;
+    Node* next;
+
+    Node(const T& value) : data(value), next(nullptr) {}
+};
+
+// The nodes of one pushRange batch, allocated as a single block. Their owner
+// destroys them in place as they are popped and frees the block with the last.
+template <typename T>
+struct NodeSlab {
+    Node<T>* nodes;
+    size_t size;
+    size_t live;
+
+    static NodeSlab allocate(size_t size) {
+        return NodeSlab{ static_cast<Node<T>*>(::operator new(size * sizeof(Node<T>))), size, size };
+    }
+
+    bool holds(const Node<T>* node) const {
+        std::less<const Node<T>*> before;
+        return !before(node, nodes) && before(node, nodes + size);
+    }
+
+    // Destroys one of the slab's nodes and returns true when it was the last,
+    // in which case the block is gone as well.
+    bool release(Node<T>* node) {
+        node->~Node<T>();
+
+        if (--live > 0) {
+            return false;
+        }
+
+        ::operator delete(nodes);
+        return true;
+    }
+};
@@ -1,174 +1,391 @@
-#include <benchmark/benchmark.h>
 #include <gtest/gtest.h>
 #include <iostream>
 #include <sstream>
 #include <fstream>
+#include <memory>
+#include <optional>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <limits>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "queue.h"
+#include "bench/centralQueuePool.h"
+
+// Fork-join Fibonacci; below the cutoff each call is computed serially.
+static uint64_t serialFib(int n) {
+    return n < 2 ? n : serialFib(n - 1) + serialFib(n - 2);
+}
 
+template <typename Pool>
+static uint64_t parallelFib(Pool& pool, int n, int cutoff) {
+    if (n <= cutoff) {
+        return serialFib(n);
+    }
 
+    uint64_t left = 0;
+    typename Pool::TaskGroup group(pool);
+    group.run([&pool, &left, n, cutoff]() { left = parallelFib(pool, n - 1, cutoff); });
+    uint64_t right = parallelFib(pool, n - 2, cutoff);
+    group.wait();
+    return left + right;
+}
 
-template <typename T>
-struct Node {
-    T data;
-    Node* next;
+TEST(StackTest, PushAndPop) {
+    Queue<int> myQueue;
 
-    Node(const T& value) : data(value), next(nullptr) {}
-};
+    ASSERT_TRUE(myQueue.isEmpty());
 
+    myQueue.push(1);
+    myQueue.push(2);
 
-template <typename T>
-class Queue {
-private:
-    Node<T>* front;
-    Node<T>* rear;
+    ASSERT_EQ(myQueue.read(), 1);
 
-public:
-    Queue() : front(nullptr), rear(nullptr) {}
+    myQueue.pop();
 
+    ASSERT_EQ(myQueue.read(), 2);
+}
 
-    void push(const T& value) {
-        Node<T>* newNode = new Node<T>(value);
+TEST(StackTest, PeekEmptyStack) {
+    Queue<int> myQueue;
+    ASSERT_EQ(myQueue.read(), 0);
+}
 
-        if (isEmpty()) {
-            front = rear = newNode;
-        }
-        else {
-            rear->next = newNode;
-            rear = newNode;
-        }
-    }
+TEST(StackTest, PopEmptyStack) {
+    Queue<int> myQueue;
 
+    ASSERT_NO_THROW(myQueue.pop());
+}
 
-    void pop() {
-        if (isEmpty()) {
-            std::cerr << "The queue is empty. The dequeue() operation cannot be performed." << std::endl;
-            return;
-        }
+TEST(QueueTest, MappedView) {
+    Queue<int> myQueue;
+    myQueue.push(1);
+    myQueue.push(2);
 
-        Node<T>* temp = front;
-        front = front->next;
-        delete temp;
+    myQueue.serializeBinary("binary_data_queue.bin");
 
-        if (isEmpty()) {
-            rear = nullptr;
-        }
-    }
+    QueueView<int> view("binary_data_queue.bin");
 
-    T read() const {
-        if (isEmpty()) {
-            std::cerr << "The queue is empty. The peek() operation cannot be performed." << std::endl;
-            return T();
-        }
+    ASSERT_EQ(view.size(), 2u);
+    EXPECT_EQ(view.read(), 1);
+    EXPECT_EQ(view.back(), 2);
+}
 
-        return front->data;
-    }
+TEST(QueueTest, SerializeAndDeserializeCompressed) {
+    Queue<int64_t> myQueue;
+    std::vector<int64_t> values = { 1000, 1001, 1002, -5, std::numeric_limits<int64_t>::max(),
+        std::numeric_limits<int64_t>::min(), 0 };
 
-    bool isEmpty() const {
-        return front == nullptr;
+    for (int64_t value : values) {
+        myQueue.push(value);
     }
-    std::string serializeText() const {
-        std::ostringstream oss;
-        Node<T>* current = front;
 
-        while (current != nullptr) {
-            oss << current->data << " ";
-            current = current->next;
-        }
+    myQueue.serializeBinary("binary_data_queue.bin", BinaryEncoding::DeltaVarint);
+
+    Queue<int64_t> newQueue;
+    newQueue.deserializeBinary("binary_data_queue.bin");
 
-        return oss.str();
+    for (int64_t value : values) {
+        ASSERT_FALSE(newQueue.isEmpty());
+        EXPECT_EQ(newQueue.read(), value);
+        newQueue.pop();
     }
 
-    void deserializeText(const std::string& data) {
+    EXPECT_TRUE(newQueue.isEmpty());
 
-        std::istringstream iss(data);
-        T value;
+    QueueView<int64_t> view("binary_data_queue.bin");
+    EXPECT_FALSE(view.is_open());
+}
 
-        while (iss >> value) {
-            push(value);
-        }
-    }
+TEST(QueueTest, CorruptStringLength) {
+    Queue<std::string> myQueue;
+    myQueue.push("first");
+    myQueue.push("second");
+    myQueue.serializeBinary("binary_data_queue.bin");
 
-    void serializeBinary(const std::string& filename) const {
-        std::ofstream ofs(filename, std::ios::binary);
+    // The first string's length claims far more bytes than the file holds.
+    std::fstream file("binary_data_queue.bin", std::ios::binary | std::ios::in | std::ios::out);
+    uint64_t huge = uint64_t(1) << 60;
+    file.seekp(sizeof(BinaryHeader));
+    file.write(reinterpret_cast<const char*>(&huge), sizeof(huge));
+    file.close();
 
-        if (ofs.is_open()) {
-            Node<T>* current = front;
+    Queue<std::string> newQueue;
+    newQueue.deserializeBinary("binary_data_queue.bin");
 
-            while (current != nullptr) {
-                ofs.write(reinterpret_cast<char*>(&current->data), sizeof(T));
-                current = current->next;
-            }
+    EXPECT_TRUE(newQueue.isEmpty());
+}
 
-            ofs.close();
-        }
-        else {
-            std::cerr << "Unable to open the file for binary serialization." << std::endl;
-        }
+TEST(QueueTest, DeltaVarintBothDecodings) {
+    std::vector<int64_t> values = { 0, 1, -1, 127, 128, -129, 65536, std::numeric_limits<int64_t>::max(),
+        std::numeric_limits<int64_t>::min(), 42 };
+
+    for (int64_t shift = 0; shift < 64; ++shift) {
+        values.push_back(int64_t(1) << shift);
+        values.push_back(-(int64_t(1) << shift) + 3);
     }
 
-    void deserializeBinary(const std::string& filename) {
+    DeltaVarintEncoder<int64_t> encoder;
 
-        std::ifstream ifs(filename, std::ios::binary);
+    for (int64_t value : values) {
+        encoder.push(value);
+    }
 
-        if (ifs.is_open()) {
-            T value;
+    BinaryWriter writer("binary_data_queue.bin");
+    writer.writeHeader(sizeof(int64_t), encoder.size(), BinaryEncoding::DeltaVarint);
+    encoder.write(writer);
+    writer.close();
 
-            while (ifs.read(reinterpret_cast<char*>(&value), sizeof(T))) {
-                push(value);
-            }
+    for (PairDecoding decoding : { PairDecoding::Scalar, PairDecoding::Shuffle }) {
+        BinaryReader reader("binary_data_queue.bin");
+        BinaryHeader header;
+        ASSERT_TRUE(reader.readHeader(header, sizeof(int64_t), BinaryEncoding::DeltaVarint));
 
-            ifs.close();
-        }
-        else {
-            std::cerr << "Unable to open the file for binary deserialization." << std::endl;
+        DeltaVarintDecoder<int64_t> decoder(decoding);
+        ASSERT_TRUE(decoder.read(reader, header.count));
+        EXPECT_EQ(decoder.pairDecoding(), shuffleSupported() ? decoding : PairDecoding::Scalar);
+
+        std::vector<int64_t> decoded;
+        int64_t batch[3];
+        size_t produced = 0;
+
+        while ((produced = decoder.next(batch, 3)) > 0) {
+            decoded.insert(decoded.end(), batch, batch + produced);
         }
+
+        EXPECT_EQ(decoded, values);
     }
-    void display() const {
-        Node<T>* current = front;
-        while (current != nullptr) {
-            std::cout << current->data << " ";
-            current = current->next;
-        }
-        std::cout << std::endl;
+}
+
+TEST(QueueTest, JournalCompaction) {
+    std::filesystem::remove_all("journal_test");
+    std::filesystem::create_directory("journal_test");
+
+    {
+        Queue<int> myQueue;
+        myQueue.openJournal("journal_test/queue");
+        myQueue.push(1);
+        myQueue.push(2);
+        myQueue.compactJournal();
+        myQueue.pop();
+        myQueue.push(3);
+        myQueue.compactJournal();
+        myQueue.push(4);
     }
 
-};
+    EXPECT_TRUE(std::filesystem::exists("journal_test/queue.snapshot.2"));
+    EXPECT_FALSE(std::filesystem::exists("journal_test/queue.journal.0"));
 
-TEST(StackTest, PushAndPop) {
-    Queue<int> myQueue;
+    Queue<int> recovered;
+    recovered.openJournal("journal_test/queue");
 
-    ASSERT_TRUE(myQueue.isEmpty());
+    EXPECT_EQ(recovered.serializeText(), "2 3 4 ");
+}
 
+static_assert([] {
+    StaticQueue<int, 3> myQueue;
     myQueue.push(1);
     myQueue.push(2);
+    myQueue.pop();
+    myQueue.push(3);
+    myQueue.push(4);
+    return myQueue.read() * 10 + static_cast<int>(myQueue.size());
+}() == 23, "StaticQueue must be usable in constant expressions");
 
-    ASSERT_EQ(myQueue.read(), 1);
+TEST(QueueTest, StaticQueueWrapsAround) {
+    StaticQueue<int, 4> myQueue;
 
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(myQueue.tryPush(i));
+    }
+
+    EXPECT_FALSE(myQueue.tryPush(4));
     myQueue.pop();
+    myQueue.pop();
+    myQueue.push(4);
+    myQueue.push(5);
+    EXPECT_EQ(myQueue.serializeText(), "2 3 4 5 ");
 
-    ASSERT_EQ(myQueue.read(), 2);
+    myQueue.serializeBinary("binary_data_queue.bin");
+
+    Queue<int> nodeQueue;
+    nodeQueue.deserializeBinary("binary_data_queue.bin");
+    EXPECT_EQ(nodeQueue.serializeText(), "2 3 4 5 ");
+
+    StaticQueue<int, 5> newQueue;
+    newQueue.deserializeBinary("binary_data_queue.bin");
+    EXPECT_EQ(newQueue.tryPop(), std::optional<int>(2));
+    EXPECT_EQ(newQueue.size(), 3u);
 }
 
-TEST(StackTest, PeekEmptyStack) {
+TEST(QueueTest, BulkRange) {
     Queue<int> myQueue;
-    ASSERT_EQ(myQueue.read(), 0);
+    myQueue.push(0);
+    myQueue.pushRange({ 1, 2, 3, 4, 5 });
+
+    EXPECT_EQ(myQueue.serializeText(), "0 1 2 3 4 5 ");
+
+    int out[4] = {};
+    EXPECT_EQ(myQueue.popInto(out, 4), 4u);
+    EXPECT_EQ(std::vector<int>(out, out + 4), std::vector<int>({ 0, 1, 2, 3 }));
+
+    std::vector<int> drained;
+    EXPECT_EQ(myQueue.drain([&](int value) { drained.push_back(value); }), 2u);
+    EXPECT_EQ(drained, std::vector<int>({ 4, 5 }));
+    EXPECT_TRUE(myQueue.isEmpty());
+
+    // The rear has to follow a batch pushed into an emptied queue.
+    myQueue.pushRange({ 6, 7 });
+    myQueue.push(8);
+    EXPECT_EQ(myQueue.serializeText(), "6 7 8 ");
+
+    // Batches and single pushes interleaved, partly popped, moved, and the
+    // rest freed by the destructor.
+    {
+        Queue<std::string> wordQueue;
+        wordQueue.pushRange({ "a", "b", "c" });
+        wordQueue.push("d");
+        wordQueue.pushRange({ "e", "f" });
+        wordQueue.pop();
+
+        Queue<std::string> movedQueue(std::move(wordQueue));
+        movedQueue.pushRange({ "g" });
+        EXPECT_EQ(movedQueue.serializeText(), "b c d e f g ");
+
+        std::string words[3];
+        EXPECT_EQ(movedQueue.popInto(words, 3), 3u);
+        EXPECT_EQ(words[2], "d");
+        EXPECT_EQ(movedQueue.serializeText(), "e f g ");
+    }
+
+    StaticQueue<int, 4> staticQueue;
+    staticQueue.push(0);
+    staticQueue.pop();
+    int values[] = { 1, 2, 3, 4, 5 };
+    EXPECT_EQ(staticQueue.pushRange(values, 5), 4u);
+    EXPECT_EQ(staticQueue.serializeText(), "1 2 3 4 ");
+    EXPECT_EQ(staticQueue.popInto(out, 3), 3u);
+    EXPECT_EQ(std::vector<int>(out, out + 3), std::vector<int>({ 1, 2, 3 }));
+    EXPECT_EQ(staticQueue.drain([](int value) { EXPECT_EQ(value, 4); }), 1u);
 }
 
-TEST(StackTest, PopEmptyStack) {
-    Queue<int> myQueue;
+TEST(WorkStealingTest, OwnerAndThief) {
+    WorkStealingDeque<int> deque(2);
 
-    ASSERT_NO_THROW(myQueue.pop());
+    EXPECT_EQ(deque.popBack(), std::nullopt);
+    EXPECT_EQ(deque.steal(), std::nullopt);
+
+    for (int i = 0; i < 10; ++i) {
+        deque.pushBack(i);
+    }
+
+    EXPECT_EQ(deque.size(), 10u);
+    EXPECT_EQ(deque.popBack(), std::optional<int>(9));
+    EXPECT_EQ(deque.steal(), std::optional<int>(0));
+    EXPECT_EQ(deque.popBack(), std::optional<int>(8));
 }
 
-static void BM_Push(benchmark::State& state) {
-    Queue<int> myQueue;
+TEST(WorkStealingTest, ConcurrentStealsTakeEachElementOnce) {
+    const int total = 200000;
+    WorkStealingDeque<int> deque(16);
+    std::vector<std::atomic<int>> taken(total);
+    std::atomic<bool> done(false);
+    std::vector<std::thread> thieves;
+
+    for (int thief = 0; thief < 3; ++thief) {
+        thieves.emplace_back([&]() {
+            while (!done.load() || !deque.isEmpty()) {
+                if (std::optional<int> value = deque.steal()) {
+                    taken[*value].fetch_add(1);
+                }
+            }
+        });
+    }
+
+    for (int i = 0; i < total; ++i) {
+        deque.pushBack(i);
+
+        if (i % 3 == 0) {
+            if (std::optional<int> value = deque.popBack()) {
+                taken[*value].fetch_add(1);
+            }
+        }
+    }
+
+    while (std::optional<int> value = deque.popBack()) {
+        taken[*value].fetch_add(1);
+    }
+
+    done.store(true);
 
-    for (auto _ : state) {
-        myQueue.push(42);
+    for (std::thread& thief : thieves) {
+        thief.join();
+    }
+
+    for (int i = 0; i < total; ++i) {
+        ASSERT_EQ(taken[i].load(), 1) << i;
     }
 }
-BENCHMARK(BM_Push);
 
-BENCHMARK_MAIN();
+TEST(WorkStealingTest, ForkJoin) {
+    ThreadPool pool(4);
+    std::vector<int> values(100000, 1);
+    std::atomic<int64_t> sum(0);
+
+    pool.parallelFor(0, values.size(), 1000, [&](size_t first, size_t last) {
+        int64_t partial = 0;
+
+        for (size_t i = first; i < last; ++i) {
+            partial += values[i];
+        }
+
+        sum.fetch_add(partial);
+    });
+
+    EXPECT_EQ(sum.load(), 100000);
+    EXPECT_EQ(parallelFib(pool, 25, 5), serialFib(25));
+
+    CentralQueuePool baseline(4);
+    EXPECT_EQ(parallelFib(baseline, 25, 5), serialFib(25));
+}
+
+TEST(QueueTest, TryPopAndTryRead) {
+    Queue<int> myQueue;
+
+    EXPECT_EQ(myQueue.tryRead(), std::nullopt);
+    EXPECT_EQ(myQueue.tryPop(), std::nullopt);
+
+    myQueue.push(0);
+    myQueue.push(5);
+
+    EXPECT_EQ(myQueue.tryRead(), std::optional<int>(0));
+    EXPECT_EQ(myQueue.tryPop(), std::optional<int>(0));
+    EXPECT_EQ(myQueue.tryPop(), std::optional<int>(5));
+    EXPECT_TRUE(myQueue.isEmpty());
+}
+
+TEST(QueueTest, DiagnosticHook) {
+    static std::vector<std::string> messages;
+    messages.clear();
+
+    Queue<int> myQueue;
+    myQueue.pop();
+
+    setDiagnosticHook([](const std::string& message) { messages.push_back(message); });
+    myQueue.pop();
+    myQueue.tryPop();
+    setDiagnosticHook(nullptr);
+
+    ASSERT_EQ(messages.size(), 1u);
+    EXPECT_EQ(messages[0], "The queue is empty. The dequeue() operation cannot be performed.");
+}
 
 int main(int argc, char** argv) {
     Queue<int> myQueue;
@@ -193,5 +410,4 @@ int main(int argc, char** argv) {
     newQueue.display();
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
-}
-
+}
\ No newline at end of file
@@ -0,0 +1,659 @@
+#pragma once
+
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <limits>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "node.h"
+#include "binaryIO.h"
+#include "diagnostics.h"
+#include "asyncWriter.h"
+#include "integerCodec.h"
+#include "textIO.h"
+#include "mappedView.h"
+#include "journal.h"
+#include "workStealing.h"
+#include "instrumentation.h"
+
+
+template <typename T>
+class Queue {
+private:
+    Node<T>* front;
+    Node<T>* rear;
+    std::unique_ptr<Journal<Queue<T>, T>> journal;
+
+    // Blocks of the nodes pushed by pushRange, oldest first. Nodes leave in the
+    // order they came, so a node from a block always belongs to the first one.
+    std::deque<NodeSlab<T>> slabs;
+
+    void releaseNode(Node<T>* node) {
+        if (!slabs.empty() && slabs.front().holds(node)) {
+            if (slabs.front().release(node)) {
+                slabs.pop_front();
+            }
+        }
+        else {
+            delete node;
+        }
+
+        Counters::released(sizeof(Node<T>));
+    }
+
+    void removeFirst() {
+        if (journal) {
+            journal->recordPop();
+        }
+
+        Node<T>* temp = front;
+        front = front->next;
+        releaseNode(temp);
+        Counters::operation();
+
+        if (isEmpty()) {
+            rear = nullptr;
+        }
+    }
+
+public:
+    // Allocation and operation counts of every queue of this type, all zero
+    // unless built with CONTAINER_INSTRUMENTATION; see instrumentation.h.
+    using Counters = CountersFor<Queue>;
+
+    static CounterSnapshot counters() {
+        return Counters::snapshot();
+    }
+
+    Queue() : front(nullptr), rear(nullptr) {}
+
+    Queue(Queue&& other) noexcept
+        : front(other.front), rear(other.rear), journal(std::move(other.journal)), slabs(std::move(other.slabs)) {
+        other.front = other.rear = nullptr;
+    }
+
+    Queue(const Queue&) = delete;
+    Queue& operator=(const Queue&) = delete;
+
+    ~Queue() {
+        while (front != nullptr) {
+            Node<T>* next = front->next;
+            releaseNode(front);
+            front = next;
+        }
+    }
+
+
+    void push(const T& value) {
+        if (journal) {
+            journal->recordPush(value);
+        }
+
+        Node<T>* newNode = new Node<T>(value);
+        Counters::allocated(sizeof(Node<T>));
+        Counters::operation();
+
+        if (isEmpty()) {
+            front = rear = newNode;
+        }
+        else {
+            rear->next = newNode;
+            rear = newNode;
+        }
+    }
+
+    // Pushes values[0] to values[count - 1] in that order. The batch's nodes
+    // are allocated together and linked in place, and the chain is attached
+    // behind rear at once instead of moving rear for every element.
+    void pushRange(const T* values, size_t count) {
+        if (count == 0) {
+            return;
+        }
+
+        // A block of one node only adds bookkeeping.
+        if (count == 1) {
+            push(values[0]);
+            return;
+        }
+
+        if (journal) {
+            for (size_t i = 0; i < count; ++i) {
+                journal->recordPush(values[i]);
+            }
+        }
+
+        NodeSlab<T> slab = NodeSlab<T>::allocate(count);
+        Node<T>* first = new (slab.nodes) Node<T>(values[0]);
+        Node<T>* last = first;
+
+        for (size_t i = 1; i < count; ++i) {
+            last->next = new (slab.nodes + i) Node<T>(values[i]);
+            last = last->next;
+        }
+
+        slabs.push_back(slab);
+        Counters::allocated(count * sizeof(Node<T>), count);
+        Counters::operation(count);
+
+        if (isEmpty()) {
+            front = first;
+        }
+        else {
+            rear->next = first;
+        }
+
+        rear = last;
+    }
+
+    void pushRange(const std::vector<T>& values) {
+        pushRange(values.data(), values.size());
+    }
+
+    // Pops up to capacity elements into out, the front first, and returns how
+    // many were popped.
+    size_t popInto(T* out, size_t capacity) {
+        size_t popped = 0;
+
+        while (popped < capacity && front != nullptr) {
+            out[popped++] = std::move(front->data);
+            removeFirst();
+        }
+
+        return popped;
+    }
+
+    // Pops every element, the front first, handing each to callback, and
+    // returns how many there were.
+    template <typename Callback>
+    size_t drain(Callback&& callback) {
+        size_t popped = 0;
+
+        while (front != nullptr) {
+            callback(std::move(front->data));
+            removeFirst();
+            ++popped;
+        }
+
+        return popped;
+    }
+
+
+    void pop() {
+        if (isEmpty()) {
+            diagnose("The queue is empty. The dequeue() operation cannot be performed.");
+            return;
+        }
+
+        removeFirst();
+    }
+
+    // Removes and returns the next element, or std::nullopt when the queue is
+    // empty, without any diagnostic output.
+    std::optional<T> tryPop() {
+        if (isEmpty()) {
+            return std::nullopt;
+        }
+
+        std::optional<T> value(std::move(front->data));
+        removeFirst();
+        return value;
+    }
+
+    T read() const {
+        if (isEmpty()) {
+            diagnose("The queue is empty. The peek() operation cannot be performed.");
+            return T();
+        }
+
+        return front->data;
+    }
+
+    std::optional<T> tryRead() const {
+        if (isEmpty()) {
+            return std::nullopt;
+        }
+
+        return front->data;
+    }
+
+    bool isEmpty() const {
+        return front == nullptr;
+    }
+
+    // Calls visitor on every element from the front to the back.
+    template <typename Visitor>
+    void visit(Visitor&& visitor) const {
+        for (Node<T>* current = front; current != nullptr; current = current->next) {
+            visitor(current->data);
+        }
+    }
+
+    // Restores the queue from the snapshot and journal files under base, then
+    // records every later push and pop there. See Journal for the file layout.
+    void openJournal(const std::string& base, JournalOptions options = JournalOptions()) {
+        journal.reset();
+        Journal<Queue<T>, T>::replay(*this, base);
+        journal = std::make_unique<Journal<Queue<T>, T>>(base, options);
+    }
+
+    void commitJournal() {
+        if (journal) {
+            journal->commit();
+        }
+    }
+
+    void compactJournal() {
+        if (journal) {
+            journal->compact();
+        }
+    }
+
+    void closeJournal() {
+        journal.reset();
+    }
+    std::string serializeText() const {
+        std::string text;
+        Node<T>* current = front;
+
+        while (current != nullptr) {
+            appendText(text, current->data);
+            text += ' ';
+            current = current->next;
+        }
+
+        Counters::serialized(text.size());
+        return text;
+    }
+
+    bool serializeText(int fd) const {
+        TextWriter writer(fd);
+        Node<T>* current = front;
+
+        while (current != nullptr) {
+            writer.write(current->data);
+            writer.write(" ");
+            current = current->next;
+        }
+
+        writer.flush();
+        Counters::serialized(writer.bytesWritten());
+        return writer.good();
+    }
+
+    void deserializeText(const std::string& data) {
+
+        TextReader reader(data);
+        T value;
+
+        while (reader.read(value)) {
+            push(value);
+        }
+    }
+
+    // BinaryEncoding::DeltaVarint compresses integral payloads; other types are
+    // always written raw.
+    void serializeBinary(const std::string& filename, BinaryEncoding encoding = BinaryEncoding::Raw) const {
+        BinaryWriter writer(filename);
+
+        if constexpr (std::is_integral_v<T> && sizeof(T) <= 8) {
+            if (writer.is_open() && encoding == BinaryEncoding::DeltaVarint) {
+                DeltaVarintEncoder<T> encoder;
+
+                for (Node<T>* current = front; current != nullptr; current = current->next) {
+                    encoder.push(current->data);
+                }
+
+                writer.writeHeader(sizeof(T), encoder.size(), BinaryEncoding::DeltaVarint);
+                encoder.write(writer);
+                Counters::serialized(writer.bytesWritten());
+                writer.close();
+                return;
+            }
+        }
+
+        if (writer.is_open()) {
+            writer.writeHeader(sizeof(T), 0);
+            Node<T>* current = front;
+            uint64_t count = 0;
+
+            while (current != nullptr) {
+                writer.writeValue(current->data);
+                current = current->next;
+                ++count;
+            }
+
+            writer.patchCount(count);
+            Counters::serialized(writer.bytesWritten());
+            writer.close();
+        }
+        else {
+            std::cerr << "Unable to open the file for binary serialization." << std::endl;
+        }
+    }
+
+    // Encodes the dump into the writer's buffers and returns once the last byte
+    // is queued; the future reports when the file is complete.
+    std::future<bool> serializeBinaryAsync(const std::string& filename, AsyncWriter& writer = AsyncWriter::shared()) const {
+        AsyncWriter::Snapshot snapshot = writer.begin(filename);
+        snapshot.writeHeader(sizeof(T), 0);
+        Node<T>* current = front;
+        uint64_t count = 0;
+
+        while (current != nullptr) {
+            snapshot.writeValue(current->data);
+            current = current->next;
+            ++count;
+        }
+
+        snapshot.patchCount(count);
+        return snapshot.finish();
+    }
+
+    void deserializeBinary(const std::string& filename) {
+
+        BinaryReader reader(filename);
+
+        if (reader.is_open()) {
+            BinaryHeader header;
+
+            if (!reader.read(&header, sizeof(header)) || !header.isValid(sizeof(T))) {
+                std::cerr << "Invalid binary header." << std::endl;
+                return;
+            }
+
+            if constexpr (std::is_integral_v<T> && sizeof(T) <= 8) {
+                if (header.encoding == BinaryEncoding::DeltaVarint) {
+                    DeltaVarintDecoder<T> decoder;
+                    T values[256];
+                    size_t decoded = 0;
+
+                    if (!decoder.read(reader, header.count)) {
+                        std::cerr << "Invalid compressed payload." << std::endl;
+                        return;
+                    }
+
+                    while ((decoded = decoder.next(values, 256)) > 0) {
+                        for (size_t i = 0; i < decoded; ++i) {
+                            push(values[i]);
+                        }
+                    }
+
+                    reader.close();
+                    return;
+                }
+            }
+
+            if (header.encoding != BinaryEncoding::Raw) {
+                std::cerr << "Invalid binary header." << std::endl;
+                return;
+            }
+
+            T value;
+
+            for (uint64_t i = 0; i < header.count && reader.readValue(value); ++i) {
+                push(value);
+            }
+
+            reader.close();
+        }
+        else {
+            std::cerr << "Unable to open the file for binary deserialization." << std::endl;
+        }
+    }
+    void display() const {
+        Node<T>* current = front;
+        while (current != nullptr) {
+            std::cout << current->data << " ";
+            current = current->next;
+        }
+        std::cout << std::endl;
+    }
+
+};
+
+// Element 0 is the front of the queue, as written by Queue::serializeBinary.
+template <typename T>
+class QueueView : public MappedView<T> {
+public:
+    using MappedView<T>::MappedView;
+
+    const T& read() const {
+        return (*this)[0];
+    }
+
+    const T& back() const {
+        return (*this)[this->size() - 1];
+    }
+};
+
+// Queue with inline ring storage for at most N elements: no heap allocation, and
+// every operation is usable in constant expressions. head and tail only grow, so
+// a full ring and an empty one are told apart by tail - head; the slot is picked
+// with a mask when N is a power of two. Dumps use the same layout as Queue.
+template <typename T, size_t N>
+class StaticQueue {
+    static_assert(N > 0, "StaticQueue needs a capacity of at least one element");
+
+private:
+    std::array<T, N> items;
+    size_t head;
+    size_t tail;
+
+    static constexpr size_t slot(size_t position) {
+        if constexpr ((N & (N - 1)) == 0) {
+            return position & (N - 1);
+        }
+        else {
+            return position % N;
+        }
+    }
+
+public:
+    constexpr StaticQueue() : items{}, head(0), tail(0) {}
+
+    static constexpr size_t capacity() {
+        return N;
+    }
+
+    constexpr size_t size() const {
+        return tail - head;
+    }
+
+    constexpr bool isEmpty() const {
+        return head == tail;
+    }
+
+    constexpr bool isFull() const {
+        return tail - head == N;
+    }
+
+    constexpr void push(const T& value) {
+        if (!tryPush(value)) {
+            diagnose("The queue is full. The enqueue() operation cannot be performed.");
+        }
+    }
+
+    constexpr bool tryPush(const T& value) {
+        if (isFull()) {
+            return false;
+        }
+
+        items[slot(tail++)] = value;
+        return true;
+    }
+
+    // Pushes as many of values[0] to values[length - 1] as fit and returns how
+    // many were pushed. The bounds are checked once and the ring is filled in
+    // at most two contiguous runs, plain loops the compiler turns into memcpy
+    // for trivially copyable types.
+    constexpr size_t pushRange(const T* values, size_t length) {
+        size_t pushed = length < N - size() ? length : N - size();
+        size_t first = slot(tail);
+        size_t run = pushed < N - first ? pushed : N - first;
+
+        for (size_t i = 0; i < run; ++i) {
+            items[first + i] = values[i];
+        }
+
+        for (size_t i = run; i < pushed; ++i) {
+            items[i - run] = values[i];
+        }
+
+        tail += pushed;
+        return pushed;
+    }
+
+    // Pops up to capacity elements into out, the front first, and returns how
+    // many were popped.
+    constexpr size_t popInto(T* out, size_t capacity) {
+        size_t popped = capacity < size() ? capacity : size();
+        size_t first = slot(head);
+        size_t run = popped < N - first ? popped : N - first;
+
+        for (size_t i = 0; i < run; ++i) {
+            out[i] = items[first + i];
+        }
+
+        for (size_t i = run; i < popped; ++i) {
+            out[i] = items[i - run];
+        }
+
+        head += popped;
+        return popped;
+    }
+
+    template <typename Callback>
+    constexpr size_t drain(Callback&& callback) {
+        size_t popped = size();
+
+        while (head != tail) {
+            callback(std::move(items[slot(head++)]));
+        }
+
+        return popped;
+    }
+
+    constexpr void pop() {
+        if (isEmpty()) {
+            diagnose("The queue is empty. The dequeue() operation cannot be performed.");
+            return;
+        }
+
+        ++head;
+    }
+
+    constexpr std::optional<T> tryPop() {
+        if (isEmpty()) {
+            return std::nullopt;
+        }
+
+        return items[slot(head++)];
+    }
+
+    constexpr T read() const {
+        if (isEmpty()) {
+            diagnose("The queue is empty. The peek() operation cannot be performed.");
+            return T();
+        }
+
+        return items[slot(head)];
+    }
+
+    constexpr std::optional<T> tryRead() const {
+        if (isEmpty()) {
+            return std::nullopt;
+        }
+
+        return items[slot(head)];
+    }
+
+    constexpr void clear() {
+        head = tail = 0;
+    }
+
+    std::string serializeText() const {
+        std::string text;
+
+        for (size_t position = head; position != tail; ++position) {
+            appendText(text, items[slot(position)]);
+            text += ' ';
+        }
+
+        return text;
+    }
+
+    bool serializeText(int fd) const {
+        TextWriter writer(fd);
+
+        for (size_t position = head; position != tail; ++position) {
+            writer.write(items[slot(position)]);
+            writer.write(" ");
+        }
+
+        writer.flush();
+        return writer.good();
+    }
+
+    void deserializeText(const std::string& data) {
+        TextReader reader(data);
+        T value;
+
+        while (!isFull() && reader.read(value)) {
+            push(value);
+        }
+    }
+
+    void serializeBinary(const std::string& filename) const {
+        BinaryWriter writer(filename);
+
+        if (writer.is_open()) {
+            writer.writeHeader(sizeof(T), size());
+
+            for (size_t position = head; position != tail; ++position) {
+                writer.writeValue(items[slot(position)]);
+            }
+
+            writer.close();
+        }
+        else {
+            std::cerr << "Unable to open the file for binary serialization." << std::endl;
+        }
+    }
+
+    void deserializeBinary(const std::string& filename) {
+        BinaryReader reader(filename);
+
+        if (reader.is_open()) {
+            BinaryHeader header;
+
+            if (!reader.readHeader(header, sizeof(T)) || header.count > N - size()) {
+                std::cerr << "Invalid binary header." << std::endl;
+                return;
+            }
+
+            T value;
+
+            for (uint64_t i = 0; i < header.count && reader.readValue(value); ++i) {
+                push(value);
+            }
+
+            reader.close();
+        }
+        else {
+            std::cerr << "Unable to open the file for binary deserialization." << std::endl;
+        }
+    }
+};
@@ -1,158 +1,337 @@
-#include <benchmark/benchmark.h>
 #include <gtest/gtest.h>
 #include <iostream>
 #include <sstream>
 #include <fstream>
+#include <memory>
+#include <optional>
+#include <array>
+#include <atomic>
+#include <iterator>
+#include <thread>
+#include <vector>
+#include "stack.h"
 
-template <typename T>
-struct Node {
-    T data;
-    Node* next;
+TEST(StackTest, PushAndPop) {
+    Stack<int> myStack;
 
-    Node(const T& value) : data(value), next(nullptr) {}
-};
+    ASSERT_TRUE(myStack.isEmpty());
 
-template <typename T>
-class Stack {
-private:
-    Node<T>* top;
+    myStack.push(1);
+    myStack.push(2);
 
-public:
-    Stack() : top(nullptr) {}
+    ASSERT_EQ(myStack.read(), 2);
 
-    void push(const T& value) {
-        Node<T>* newNode = new Node<T>(value);
-        newNode->next = top;
-        top = newNode;
-    }
+    myStack.pop();
 
-    void pop() {
-        if (isEmpty()) {
-            std::cerr << "The stack is empty. The pop() operation cannot be performed." << std::endl;
-            return;
-        }
+    ASSERT_EQ(myStack.read(), 1);
+}
 
-        Node<T>* temp = top;
-        top = top->next;
-        delete temp;
-    }
+TEST(StackTest, PeekEmptyStack) {
+    Stack<int> myStack;
+    ASSERT_EQ(myStack.read(), 0);
+}
 
-    T read() const {
-        if (isEmpty()) {
-            std::cerr << "The stack is empty. The peek() operation cannot be performed." << std::endl;
-            return T();
-        }
+TEST(StackTest, PopEmptyStack) {
+    Stack<int> myStack;
 
-        return top->data;
-    }
+    ASSERT_NO_THROW(myStack.pop());
+}
 
-    bool isEmpty() const {
-        return top == nullptr;
-    }
+TEST(StackTest, TryPopAndTryRead) {
+    Stack<int> myStack;
 
-    std::string serializeText() const {
-        std::ostringstream oss;
-        Node<T>* current = top;
+    EXPECT_EQ(myStack.tryPop(), std::nullopt);
 
-        while (current != nullptr) {
-            oss << current->data << " ";
-            current = current->next;
-        }
+    myStack.push(1);
+    myStack.push(2);
 
-        return oss.str();
-    }
+    EXPECT_EQ(myStack.tryRead(), std::optional<int>(2));
+    EXPECT_EQ(myStack.tryPop(), std::optional<int>(2));
+    EXPECT_EQ(myStack.tryPop(), std::optional<int>(1));
+    EXPECT_EQ(myStack.tryRead(), std::nullopt);
+}
 
-    void deserializeText(const std::string& data) {
+static_assert([] {
+    StaticStack<int, 4> myStack;
+    myStack.push(1);
+    myStack.push(2);
+    myStack.push(3);
+    myStack.pop();
+    return myStack.read() * 10 + static_cast<int>(myStack.size());
+}() == 22, "StaticStack must be usable in constant expressions");
 
-        std::istringstream iss(data);
-        T value;
+TEST(StackTest, StaticStack) {
+    StaticStack<int, 3> myStack;
 
-        while (iss >> value) {
-            push(value);
-        }
+    EXPECT_TRUE(myStack.tryPush(1));
+    EXPECT_TRUE(myStack.tryPush(2));
+    EXPECT_TRUE(myStack.tryPush(3));
+    EXPECT_FALSE(myStack.tryPush(4));
+    EXPECT_EQ(myStack.serializeText(), "3 2 1 ");
+
+    myStack.serializeBinary("binary_data_static.bin");
+
+    Stack<int> nodeStack;
+    nodeStack.deserializeBinary("binary_data_static.bin");
+    EXPECT_EQ(nodeStack.serializeText(), "3 2 1 ");
+
+    StaticStack<int, 3> newStack;
+    newStack.deserializeBinary("binary_data_static.bin");
+    EXPECT_EQ(newStack.tryPop(), std::optional<int>(3));
+
+    newStack.clear();
+    newStack.deserializeText("7 8");
+    EXPECT_EQ(newStack.serializeText(), "7 8 ");
+}
+
+TEST(StackTest, BulkRange) {
+    Stack<int> myStack;
+    myStack.push(0);
+    myStack.pushRange({ 1, 2, 3, 4, 5 });
+    myStack.pushRange(nullptr, 0);
+
+    EXPECT_EQ(myStack.serializeText(), "5 4 3 2 1 0 ");
+
+    int out[4] = {};
+    EXPECT_EQ(myStack.popInto(out, 4), 4u);
+    EXPECT_EQ(std::vector<int>(out, out + 4), std::vector<int>({ 5, 4, 3, 2 }));
+
+    std::vector<int> drained;
+    EXPECT_EQ(myStack.drain([&](int value) { drained.push_back(value); }), 2u);
+    EXPECT_EQ(drained, std::vector<int>({ 1, 0 }));
+    EXPECT_TRUE(myStack.isEmpty());
+    EXPECT_EQ(myStack.popInto(out, 4), 0u);
+
+    // Batches and single pushes interleaved, partly popped, and the rest freed
+    // by the destructor.
+    {
+        Stack<std::string> wordStack;
+        wordStack.pushRange({ "a", "b", "c" });
+        wordStack.push("d");
+        wordStack.pushRange({ "e", "f" });
+        wordStack.pop();
+        wordStack.pushRange({ "g" });
+        EXPECT_EQ(wordStack.serializeText(), "g e d c b a ");
+
+        std::string words[3];
+        EXPECT_EQ(wordStack.popInto(words, 3), 3u);
+        EXPECT_EQ(words[2], "d");
+        EXPECT_EQ(wordStack.serializeText(), "c b a ");
     }
 
-    void serializeBinary(const std::string& filename) const {
-        std::ofstream ofs(filename, std::ios::binary);
+    StaticStack<int, 4> staticStack;
+    int values[] = { 1, 2, 3, 4, 5 };
+    EXPECT_EQ(staticStack.pushRange(values, 5), 4u);
+    EXPECT_EQ(staticStack.popInto(out, 3), 3u);
+    EXPECT_EQ(std::vector<int>(out, out + 3), std::vector<int>({ 4, 3, 2 }));
+    EXPECT_EQ(staticStack.drain([](int value) { EXPECT_EQ(value, 1); }), 1u);
+}
 
-        if (ofs.is_open()) {
-            Node<T>* current = top;
+TEST(StackTest, PersistentSnapshot) {
+    PersistentStack<int> myStack;
+    myStack.push(1);
+    myStack.push(2);
 
-            while (current != nullptr) {
-                ofs.write(reinterpret_cast<char*>(&current->data), sizeof(T));
-                current = current->next;
-            }
+    PersistentStack<int>::Snapshot before = myStack.snapshot();
+    myStack.pop();
+    myStack.push(3);
+    myStack.push(4);
 
-            ofs.close();
-        }
-        else {
-            std::cerr << "Unable to open the file for binary serialization." << std::endl;
+    EXPECT_EQ(before.serializeText(), "2 1 ");
+    EXPECT_EQ(before.size(), 2u);
+    EXPECT_EQ(myStack.serializeText(), "4 3 1 ");
+    EXPECT_EQ(myStack.size(), 3u);
+
+    before.serializeBinary("binary_data_persistent.bin");
+
+    Stack<int> nodeStack;
+    nodeStack.deserializeBinary("binary_data_persistent.bin");
+    EXPECT_EQ(nodeStack.serializeText(), "2 1 ");
+
+    PersistentStack<int> newStack;
+    newStack.deserializeBinary("binary_data_persistent.bin");
+    EXPECT_EQ(newStack.tryPop(), std::optional<int>(2));
+}
+
+TEST(StackTest, PersistentSnapshotOutlivesStack) {
+    PersistentStack<int>::Snapshot snapshot;
+
+    {
+        PersistentStack<int> myStack;
+
+        for (int i = 0; i < 1000000; ++i) {
+            myStack.push(i);
         }
+
+        snapshot = myStack.snapshot();
     }
 
-    void deserializeBinary(const std::string& filename) {
+    EXPECT_EQ(snapshot.size(), 1000000u);
+    EXPECT_EQ(snapshot.read(), 999999);
 
-        std::ifstream ifs(filename, std::ios::binary);
+    snapshot = PersistentStack<int>::Snapshot();
+    EXPECT_TRUE(snapshot.isEmpty());
+}
+
+TEST(StackTest, PersistentSnapshotsDroppedTogether) {
+    for (int round = 0; round < 4; ++round) {
+        std::vector<PersistentStack<int>::Snapshot> snapshots;
 
-        if (ifs.is_open()) {
-            T value;
+        {
+            PersistentStack<int> myStack;
 
-            while (ifs.read(reinterpret_cast<char*>(&value), sizeof(T))) {
-                push(value);
+            for (int i = 0; i < 1000000; ++i) {
+                myStack.push(i);
             }
 
-            ifs.close();
+            snapshots.assign(4, myStack.snapshot());
         }
-        else {
-            std::cerr << "Unable to open the file for binary deserialization." << std::endl;
+
+        std::vector<std::thread> threads;
+
+        for (PersistentStack<int>::Snapshot& snapshot : snapshots) {
+            threads.emplace_back([&snapshot]() { snapshot = PersistentStack<int>::Snapshot(); });
         }
-    }
 
-    void print() const {
-        Node<T>* current = top;
-        while (current != nullptr) {
-            std::cout << current->data << " ";
-            current = current->next;
+        for (std::thread& thread : threads) {
+            thread.join();
         }
-        std::cout << std::endl;
-    }
-};
-TEST(StackTest, PushAndPop) {
-    Stack<int> myStack;
 
-    ASSERT_TRUE(myStack.isEmpty());
+        EXPECT_TRUE(snapshots.front().isEmpty());
+    }
+}
 
+TEST(StackTest, SerializeAndDeserializeBinary) {
+    Stack<int> myStack;
     myStack.push(1);
     myStack.push(2);
+    myStack.push(3);
 
-    ASSERT_EQ(myStack.read(), 2);
+    myStack.serializeBinary("binary_data.bin");
 
-    myStack.pop();
+    Stack<int> newStack;
+    newStack.deserializeBinary("binary_data.bin");
 
-    ASSERT_EQ(myStack.read(), 1);
+    EXPECT_EQ(newStack.serializeText(), "3 2 1 ");
 }
 
-TEST(StackTest, PeekEmptyStack) {
-    Stack<int> myStack;
-    ASSERT_EQ(myStack.read(), 0);
+TEST(StackTest, DeserializeBinaryRejectsForeignFile) {
+    std::ofstream ofs("binary_data.bin", std::ios::binary);
+    ofs << "not a container dump";
+    ofs.close();
+
+    Stack<int> newStack;
+    newStack.deserializeBinary("binary_data.bin");
+
+    EXPECT_TRUE(newStack.isEmpty());
 }
 
-TEST(StackTest, PopEmptyStack) {
+TEST(StackTest, MappedView) {
     Stack<int> myStack;
+    myStack.push(1);
+    myStack.push(2);
+    myStack.push(3);
 
-    ASSERT_NO_THROW(myStack.pop());
+    myStack.serializeBinary("binary_data.bin");
+
+    StackView<int> view("binary_data.bin");
+
+    ASSERT_TRUE(view.is_open());
+    EXPECT_EQ(view.size(), 3u);
+    EXPECT_EQ(view.read(), 3);
+    EXPECT_EQ(std::vector<int>(view.begin(), view.end()), std::vector<int>({ 3, 2, 1 }));
 }
 
-static void BM_Push(benchmark::State& state) {
+TEST(StackTest, JournalRecovery) {
+    std::filesystem::remove_all("journal_test");
+    std::filesystem::create_directory("journal_test");
+
+    {
+        Stack<int> myStack;
+        myStack.openJournal("journal_test/stack", { 2, FsyncPolicy::Never });
+        myStack.push(1);
+        myStack.push(2);
+        myStack.push(3);
+        myStack.pop();
+        myStack.push(4);
+    }
+
+    Stack<int> recovered;
+    recovered.openJournal("journal_test/stack");
+
+    EXPECT_EQ(recovered.serializeText(), "4 2 1 ");
+
+    // Loaded elements are journaled like pushes.
+    std::filesystem::remove_all("journal_test");
+    std::filesystem::create_directory("journal_test");
+
+    {
+        Stack<int> myStack;
+        myStack.openJournal("journal_test/stack", { 2, FsyncPolicy::Never });
+        myStack.push(0);
+        myStack.deserializeText("3 2 1");
+        myStack.push(9);
+        myStack.serializeBinary("binary_data.bin");
+        myStack.deserializeBinary("binary_data.bin");
+    }
+
+    Stack<int> loaded;
+    loaded.openJournal("journal_test/stack");
+
+    EXPECT_EQ(loaded.serializeText(), "9 3 2 1 0 9 3 2 1 0 ");
+}
+
+TEST(StackTest, SerializeBinaryAsync) {
     Stack<int> myStack;
 
-    for (auto _ : state) {
-        myStack.push(42);
+    for (int i = 0; i < 100000; ++i) {
+        myStack.push(i);
     }
+
+    AsyncWriter writer(4096, 2);
+    std::future<bool> done = myStack.serializeBinaryAsync("binary_data_async.bin", writer);
+
+    ASSERT_TRUE(done.get());
+
+    StackView<int> view("binary_data_async.bin");
+
+    ASSERT_EQ(view.size(), 100000u);
+    EXPECT_EQ(view.read(), 99999);
+    EXPECT_EQ(view[99999], 0);
 }
-BENCHMARK(BM_Push);
 
-BENCHMARK_MAIN();
+// The tests are built with CONTAINER_INSTRUMENTATION. Stack<long> is used by
+// this test only, so its counters start from zero.
+TEST(StackTest, Counters) {
+    {
+        Stack<long> myStack;
+
+        for (long i = 0; i < 100; ++i) {
+            myStack.push(i);
+        }
+
+        myStack.pop();
+
+        std::thread other([&myStack]() { myStack.push(100); });
+        other.join();
+
+        std::string text = myStack.serializeText();
+        CounterSnapshot counters = Stack<long>::counters();
+
+        EXPECT_EQ(counters[Counter::LiveNodes], 100);
+        EXPECT_EQ(counters[Counter::LiveBytes], static_cast<int64_t>(100 * sizeof(Node<long>)));
+        EXPECT_EQ(counters[Counter::Allocations], 101);
+        EXPECT_EQ(counters[Counter::Operations], 102);
+        EXPECT_EQ(counters[Counter::SerializedBytes], static_cast<int64_t>(text.size()));
+        EXPECT_DOUBLE_EQ(counters.allocationsPerOperation(), 101.0 / 102.0);
+    }
+
+    CounterSnapshot counters = Stack<long>::counters();
+
+    EXPECT_EQ(counters[Counter::LiveNodes], 0);
+    EXPECT_EQ(counters[Counter::LiveBytes], 0);
+    EXPECT_EQ(counters[Counter::Allocations], 101);
+}
 
 int main(int argc, char** argv) {
     Stack<int> myStack;
@@ -176,6 +355,4 @@ int main(int argc, char** argv) {
 
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
-}
-
-
+}
\ No newline at end of file
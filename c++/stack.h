@@ -0,0 +1,871 @@
+#pragma once
+
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <array>
+#include <atomic>
+#include <iterator>
+#include <thread>
+#include <vector>
+#include "node.h"
+#include "binaryIO.h"
+#include "diagnostics.h"
+#include "asyncWriter.h"
+#include "textIO.h"
+#include "mappedView.h"
+#include "journal.h"
+#include "instrumentation.h"
+
+template <typename T>
+class Stack {
+private:
+    Node<T>* top;
+    std::unique_ptr<Journal<Stack<T>, T>> journal;
+
+    // Blocks of the nodes pushed by pushRange, oldest first. Nodes leave in the
+    // reverse of the order they came, so a node from a block always belongs to
+    // the last one.
+    std::vector<NodeSlab<T>> slabs;
+
+    void releaseNode(Node<T>* node) {
+        if (!slabs.empty() && slabs.back().holds(node)) {
+            if (slabs.back().release(node)) {
+                slabs.pop_back();
+            }
+        }
+        else {
+            delete node;
+        }
+
+        Counters::released(sizeof(Node<T>));
+    }
+
+    // Dumps list the stack from the top down, so loaded elements are chained in
+    // file order and the chain is placed above the existing elements. The
+    // journal gets one push per element, the bottom one first, so that replay
+    // stacks them the same way.
+    void pushChain(Node<T>* first, Node<T>* last) {
+        if (last == nullptr) {
+            return;
+        }
+
+        if (journal) {
+            std::vector<const T*> loaded;
+
+            for (Node<T>* node = first; node != nullptr; node = node->next) {
+                loaded.push_back(&node->data);
+            }
+
+            for (size_t index = loaded.size(); index-- > 0;) {
+                journal->recordPush(*loaded[index]);
+            }
+        }
+
+        last->next = top;
+        top = first;
+    }
+
+    static void appendToChain(Node<T>*& first, Node<T>*& last, const T& value) {
+        Node<T>* newNode = new Node<T>(value);
+        Counters::allocated(sizeof(Node<T>));
+        Counters::operation();
+
+        if (last == nullptr) {
+            first = newNode;
+        }
+        else {
+            last->next = newNode;
+        }
+
+        last = newNode;
+    }
+
+    void removeFirst() {
+        if (journal) {
+            journal->recordPop();
+        }
+
+        Node<T>* temp = top;
+        top = top->next;
+        releaseNode(temp);
+        Counters::operation();
+    }
+
+public:
+    // Allocation and operation counts of every stack of this type, all zero
+    // unless built with CONTAINER_INSTRUMENTATION; see instrumentation.h.
+    using Counters = CountersFor<Stack>;
+
+    static CounterSnapshot counters() {
+        return Counters::snapshot();
+    }
+
+    Stack() : top(nullptr) {}
+
+    Stack(const Stack&) = delete;
+    Stack& operator=(const Stack&) = delete;
+
+    ~Stack() {
+        while (top != nullptr) {
+            Node<T>* next = top->next;
+            releaseNode(top);
+            top = next;
+        }
+    }
+
+    void push(const T& value) {
+        if (journal) {
+            journal->recordPush(value);
+        }
+
+        Node<T>* newNode = new Node<T>(value);
+        Counters::allocated(sizeof(Node<T>));
+        Counters::operation();
+        newNode->next = top;
+        top = newNode;
+    }
+
+    // Pushes values[0] to values[count - 1] in that order, so the last one ends
+    // up on top. The batch's nodes are allocated together, values[0] first, and
+    // the chain is put on the stack with a single update of top.
+    void pushRange(const T* values, size_t count) {
+        if (count == 0) {
+            return;
+        }
+
+        // A block of one node only adds bookkeeping.
+        if (count == 1) {
+            push(values[0]);
+            return;
+        }
+
+        if (journal) {
+            for (size_t i = 0; i < count; ++i) {
+                journal->recordPush(values[i]);
+            }
+        }
+
+        NodeSlab<T> slab = NodeSlab<T>::allocate(count);
+        Node<T>* last = new (slab.nodes) Node<T>(values[0]);
+        Node<T>* first = last;
+
+        for (size_t i = 1; i < count; ++i) {
+            Node<T>* newNode = new (slab.nodes + i) Node<T>(values[i]);
+            newNode->next = first;
+            first = newNode;
+        }
+
+        slabs.push_back(slab);
+        Counters::allocated(count * sizeof(Node<T>), count);
+        Counters::operation(count);
+        pushChain(first, last);
+    }
+
+    void pushRange(const std::vector<T>& values) {
+        pushRange(values.data(), values.size());
+    }
+
+    // Pops up to capacity elements into out, the top first, and returns how
+    // many were popped.
+    size_t popInto(T* out, size_t capacity) {
+        size_t popped = 0;
+
+        while (popped < capacity && top != nullptr) {
+            out[popped++] = std::move(top->data);
+            removeFirst();
+        }
+
+        return popped;
+    }
+
+    // Pops every element, the top first, handing each to callback, and returns
+    // how many there were.
+    template <typename Callback>
+    size_t drain(Callback&& callback) {
+        size_t popped = 0;
+
+        while (top != nullptr) {
+            callback(std::move(top->data));
+            removeFirst();
+            ++popped;
+        }
+
+        return popped;
+    }
+
+    // Calls visitor on every element from the top down.
+    template <typename Visitor>
+    void visit(Visitor&& visitor) const {
+        for (Node<T>* current = top; current != nullptr; current = current->next) {
+            visitor(current->data);
+        }
+    }
+
+    // Restores the stack from the snapshot and journal files under base, then
+    // records every later push and pop there. See Journal for the file layout.
+    void openJournal(const std::string& base, JournalOptions options = JournalOptions()) {
+        journal.reset();
+        Journal<Stack<T>, T>::replay(*this, base);
+        journal = std::make_unique<Journal<Stack<T>, T>>(base, options);
+    }
+
+    void commitJournal() {
+        if (journal) {
+            journal->commit();
+        }
+    }
+
+    void compactJournal() {
+        if (journal) {
+            journal->compact();
+        }
+    }
+
+    void closeJournal() {
+        journal.reset();
+    }
+
+    void pop() {
+        if (isEmpty()) {
+            diagnose("The stack is empty. The pop() operation cannot be performed.");
+            return;
+        }
+
+        removeFirst();
+    }
+
+    // Removes and returns the next element, or std::nullopt when the stack is
+    // empty, without any diagnostic output.
+    std::optional<T> tryPop() {
+        if (isEmpty()) {
+            return std::nullopt;
+        }
+
+        std::optional<T> value(std::move(top->data));
+        removeFirst();
+        return value;
+    }
+
+    T read() const {
+        if (isEmpty()) {
+            diagnose("The stack is empty. The peek() operation cannot be performed.");
+            return T();
+        }
+
+        return top->data;
+    }
+
+    std::optional<T> tryRead() const {
+        if (isEmpty()) {
+            return std::nullopt;
+        }
+
+        return top->data;
+    }
+
+    bool isEmpty() const {
+        return top == nullptr;
+    }
+
+    std::string serializeText() const {
+        std::string text;
+        Node<T>* current = top;
+
+        while (current != nullptr) {
+            appendText(text, current->data);
+            text += ' ';
+            current = current->next;
+        }
+
+        Counters::serialized(text.size());
+        return text;
+    }
+
+    bool serializeText(int fd) const {
+        TextWriter writer(fd);
+        Node<T>* current = top;
+
+        while (current != nullptr) {
+            writer.write(current->data);
+            writer.write(" ");
+            current = current->next;
+        }
+
+        writer.flush();
+        Counters::serialized(writer.bytesWritten());
+        return writer.good();
+    }
+
+    void deserializeText(const std::string& data) {
+
+        TextReader reader(data);
+        T value;
+        Node<T>* first = nullptr;
+        Node<T>* last = nullptr;
+
+        while (reader.read(value)) {
+            appendToChain(first, last, value);
+        }
+
+        pushChain(first, last);
+    }
+
+    void serializeBinary(const std::string& filename) const {
+        BinaryWriter writer(filename);
+
+        if (writer.is_open()) {
+            writer.writeHeader(sizeof(T), 0);
+            Node<T>* current = top;
+            uint64_t count = 0;
+
+            while (current != nullptr) {
+                writer.writeValue(current->data);
+                current = current->next;
+                ++count;
+            }
+
+            writer.patchCount(count);
+            Counters::serialized(writer.bytesWritten());
+            writer.close();
+        }
+        else {
+            std::cerr << "Unable to open the file for binary serialization." << std::endl;
+        }
+    }
+
+    // Encodes the dump into the writer's buffers and returns once the last byte
+    // is queued; the future reports when the file is complete.
+    std::future<bool> serializeBinaryAsync(const std::string& filename, AsyncWriter& writer = AsyncWriter::shared()) const {
+        AsyncWriter::Snapshot snapshot = writer.begin(filename);
+        snapshot.writeHeader(sizeof(T), 0);
+        Node<T>* current = top;
+        uint64_t count = 0;
+
+        while (current != nullptr) {
+            snapshot.writeValue(current->data);
+            current = current->next;
+            ++count;
+        }
+
+        snapshot.patchCount(count);
+        return snapshot.finish();
+    }
+
+    void deserializeBinary(const std::string& filename) {
+
+        BinaryReader reader(filename);
+
+        if (reader.is_open()) {
+            BinaryHeader header;
+
+            if (!reader.readHeader(header, sizeof(T))) {
+                std::cerr << "Invalid binary header." << std::endl;
+                return;
+            }
+
+            T value;
+            Node<T>* first = nullptr;
+            Node<T>* last = nullptr;
+
+            for (uint64_t i = 0; i < header.count && reader.readValue(value); ++i) {
+                appendToChain(first, last, value);
+            }
+
+            pushChain(first, last);
+
+            reader.close();
+        }
+        else {
+            std::cerr << "Unable to open the file for binary deserialization." << std::endl;
+        }
+    }
+
+    void print() const {
+        Node<T>* current = top;
+        while (current != nullptr) {
+            std::cout << current->data << " ";
+            current = current->next;
+        }
+        std::cout << std::endl;
+    }
+};
+
+// Element 0 is the top of the stack, as written by Stack::serializeBinary.
+template <typename T>
+class StackView : public MappedView<T> {
+public:
+    using MappedView<T>::MappedView;
+
+    const T& read() const {
+        return (*this)[0];
+    }
+};
+
+// Stack with inline storage for at most N elements: no heap allocation, and every
+// operation is usable in constant expressions. Dumps use the same layout as Stack.
+template <typename T, size_t N>
+class StaticStack {
+    static_assert(N > 0, "StaticStack needs a capacity of at least one element");
+
+private:
+    std::array<T, N> items;
+    size_t count;
+
+public:
+    constexpr StaticStack() : items{}, count(0) {}
+
+    static constexpr size_t capacity() {
+        return N;
+    }
+
+    constexpr size_t size() const {
+        return count;
+    }
+
+    constexpr bool isEmpty() const {
+        return count == 0;
+    }
+
+    constexpr bool isFull() const {
+        return count == N;
+    }
+
+    constexpr void push(const T& value) {
+        if (!tryPush(value)) {
+            diagnose("The stack is full. The push() operation cannot be performed.");
+        }
+    }
+
+    constexpr bool tryPush(const T& value) {
+        if (isFull()) {
+            return false;
+        }
+
+        items[count++] = value;
+        return true;
+    }
+
+    // Pushes as many of values[0] to values[length - 1] as fit and returns how
+    // many were pushed. The bounds are checked once, so the copy is a plain
+    // loop the compiler turns into a memcpy for trivially copyable types.
+    constexpr size_t pushRange(const T* values, size_t length) {
+        size_t pushed = length < N - count ? length : N - count;
+
+        for (size_t i = 0; i < pushed; ++i) {
+            items[count + i] = values[i];
+        }
+
+        count += pushed;
+        return pushed;
+    }
+
+    // Pops up to capacity elements into out, the top first, and returns how
+    // many were popped.
+    constexpr size_t popInto(T* out, size_t capacity) {
+        size_t popped = capacity < count ? capacity : count;
+
+        for (size_t i = 0; i < popped; ++i) {
+            out[i] = items[count - 1 - i];
+        }
+
+        count -= popped;
+        return popped;
+    }
+
+    template <typename Callback>
+    constexpr size_t drain(Callback&& callback) {
+        size_t popped = count;
+
+        while (count > 0) {
+            callback(std::move(items[--count]));
+        }
+
+        return popped;
+    }
+
+    constexpr void pop() {
+        if (isEmpty()) {
+            diagnose("The stack is empty. The pop() operation cannot be performed.");
+            return;
+        }
+
+        --count;
+    }
+
+    constexpr std::optional<T> tryPop() {
+        if (isEmpty()) {
+            return std::nullopt;
+        }
+
+        return items[--count];
+    }
+
+    constexpr T read() const {
+        if (isEmpty()) {
+            diagnose("The stack is empty. The peek() operation cannot be performed.");
+            return T();
+        }
+
+        return items[count - 1];
+    }
+
+    constexpr std::optional<T> tryRead() const {
+        if (isEmpty()) {
+            return std::nullopt;
+        }
+
+        return items[count - 1];
+    }
+
+    constexpr void clear() {
+        count = 0;
+    }
+
+    std::string serializeText() const {
+        std::string text;
+
+        for (size_t index = count; index-- > 0;) {
+            appendText(text, items[index]);
+            text += ' ';
+        }
+
+        return text;
+    }
+
+    bool serializeText(int fd) const {
+        TextWriter writer(fd);
+
+        for (size_t index = count; index-- > 0;) {
+            writer.write(items[index]);
+            writer.write(" ");
+        }
+
+        writer.flush();
+        return writer.good();
+    }
+
+    // Text and binary dumps list the stack from the top down, so the loaded
+    // elements keep that order above the existing ones.
+    void deserializeText(const std::string& data) {
+        TextReader reader(data);
+        std::array<T, N> loaded{};
+        size_t loadedCount = 0;
+        T value;
+
+        while (loadedCount < N - count && reader.read(value)) {
+            loaded[loadedCount++] = value;
+        }
+
+        while (loadedCount > 0) {
+            items[count++] = loaded[--loadedCount];
+        }
+    }
+
+    void serializeBinary(const std::string& filename) const {
+        BinaryWriter writer(filename);
+
+        if (writer.is_open()) {
+            writer.writeHeader(sizeof(T), count);
+
+            for (size_t index = count; index-- > 0;) {
+                writer.writeValue(items[index]);
+            }
+
+            writer.close();
+        }
+        else {
+            std::cerr << "Unable to open the file for binary serialization." << std::endl;
+        }
+    }
+
+    void deserializeBinary(const std::string& filename) {
+        BinaryReader reader(filename);
+
+        if (reader.is_open()) {
+            BinaryHeader header;
+
+            if (!reader.readHeader(header, sizeof(T)) || header.count > N - count) {
+                std::cerr << "Invalid binary header." << std::endl;
+                return;
+            }
+
+            T value;
+            size_t loaded = 0;
+
+            while (loaded < header.count && reader.readValue(value)) {
+                items[count + header.count - 1 - loaded++] = value;
+            }
+
+            if (loaded == header.count) {
+                count += loaded;
+            }
+
+            reader.close();
+        }
+        else {
+            std::cerr << "Unable to open the file for binary deserialization." << std::endl;
+        }
+    }
+};
+
+// Stack whose nodes are never changed once pushed. A node only points at older
+// ones, so a snapshot is just a counted reference to the current top: taking one
+// is O(1), and readers can walk and serialize it without locks while a single
+// writer keeps pushing and popping. Nodes are freed when the last stack or
+// snapshot that reaches them lets go.
+template <typename T>
+class PersistentStack {
+private:
+    struct PersistentNode {
+        T data;
+        std::shared_ptr<PersistentNode> next;
+        size_t depth;
+
+        PersistentNode(const T& value, std::shared_ptr<PersistentNode> next)
+            : data(value), next(std::move(next)), depth(this->next ? this->next->depth + 1 : 1) {}
+
+        // Freeing the last reference to a long chain would otherwise recurse one
+        // destructor frame per node. Only the owner that wins the drop of a node
+        // runs this, so it walks the tail that nothing else shares and frees it a
+        // node at a time; each of those nodes finds its own next already taken.
+        ~PersistentNode() {
+            std::shared_ptr<PersistentNode> rest = std::move(next);
+
+            while (rest && rest.use_count() == 1) {
+                rest = std::move(rest->next);
+            }
+        }
+    };
+
+    using NodePtr = std::shared_ptr<PersistentNode>;
+
+    NodePtr top;
+
+    // Writes come from the owning thread only; loads come from any reader.
+    static NodePtr load(const NodePtr& node) {
+        return std::atomic_load_explicit(&node, std::memory_order_acquire);
+    }
+
+    static void store(NodePtr& node, NodePtr value) {
+        std::atomic_store_explicit(&node, std::move(value), std::memory_order_release);
+    }
+
+public:
+    class Snapshot {
+    public:
+        class Iterator {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = T;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const T*;
+            using reference = const T&;
+
+            explicit Iterator(const PersistentNode* node = nullptr) : node(node) {}
+
+            reference operator*() const {
+                return node->data;
+            }
+
+            pointer operator->() const {
+                return &node->data;
+            }
+
+            Iterator& operator++() {
+                node = node->next.get();
+                return *this;
+            }
+
+            Iterator operator++(int) {
+                Iterator previous = *this;
+                ++*this;
+                return previous;
+            }
+
+            bool operator==(const Iterator& other) const {
+                return node == other.node;
+            }
+
+            bool operator!=(const Iterator& other) const {
+                return node != other.node;
+            }
+
+        private:
+            const PersistentNode* node;
+        };
+
+        Snapshot() : top() {}
+        explicit Snapshot(NodePtr top) : top(std::move(top)) {}
+
+        Snapshot(const Snapshot&) = default;
+        Snapshot(Snapshot&&) = default;
+        Snapshot& operator=(const Snapshot&) = default;
+        Snapshot& operator=(Snapshot&&) = default;
+
+        bool isEmpty() const {
+            return top == nullptr;
+        }
+
+        size_t size() const {
+            return top ? top->depth : 0;
+        }
+
+        T read() const {
+            if (isEmpty()) {
+                diagnose("The stack is empty. The peek() operation cannot be performed.");
+                return T();
+            }
+
+            return top->data;
+        }
+
+        // Iterates from the top of the stack down.
+        Iterator begin() const {
+            return Iterator(top.get());
+        }
+
+        Iterator end() const {
+            return Iterator();
+        }
+
+        std::string serializeText() const {
+            std::string text;
+
+            for (const T& value : *this) {
+                appendText(text, value);
+                text += ' ';
+            }
+
+            return text;
+        }
+
+        bool serializeText(int fd) const {
+            TextWriter writer(fd);
+
+            for (const T& value : *this) {
+                writer.write(value);
+                writer.write(" ");
+            }
+
+            writer.flush();
+            return writer.good();
+        }
+
+        // Same layout as Stack::serializeBinary.
+        void serializeBinary(const std::string& filename) const {
+            BinaryWriter writer(filename);
+
+            if (writer.is_open()) {
+                writer.writeHeader(sizeof(T), size());
+
+                for (const T& value : *this) {
+                    writer.writeValue(value);
+                }
+
+                writer.close();
+            }
+            else {
+                std::cerr << "Unable to open the file for binary serialization." << std::endl;
+            }
+        }
+
+    private:
+        NodePtr top;
+    };
+
+    PersistentStack() : top() {}
+
+    PersistentStack(const PersistentStack&) = delete;
+    PersistentStack& operator=(const PersistentStack&) = delete;
+
+    ~PersistentStack() {
+        store(top, nullptr);
+    }
+
+    void push(const T& value) {
+        store(top, std::make_shared<PersistentNode>(value, top));
+    }
+
+    void pop() {
+        if (isEmpty()) {
+            diagnose("The stack is empty. The pop() operation cannot be performed.");
+            return;
+        }
+
+        store(top, top->next);
+    }
+
+    std::optional<T> tryPop() {
+        if (isEmpty()) {
+            return std::nullopt;
+        }
+
+        std::optional<T> value(top->data);
+        pop();
+        return value;
+    }
+
+    T read() const {
+        if (isEmpty()) {
+            diagnose("The stack is empty. The peek() operation cannot be performed.");
+            return T();
+        }
+
+        return top->data;
+    }
+
+    bool isEmpty() const {
+        return top == nullptr;
+    }
+
+    size_t size() const {
+        return top ? top->depth : 0;
+    }
+
+    // Safe to call from any thread while the owner pushes and pops.
+    Snapshot snapshot() const {
+        return Snapshot(load(top));
+    }
+
+    std::string serializeText() const {
+        return snapshot().serializeText();
+    }
+
+    void serializeBinary(const std::string& filename) const {
+        snapshot().serializeBinary(filename);
+    }
+
+    // Dumps list the stack from the top down; the loaded elements keep that
+    // order above the existing ones.
+    void deserializeBinary(const std::string& filename) {
+        BinaryReader reader(filename);
+
+        if (reader.is_open()) {
+            BinaryHeader header;
+
+            if (!reader.readHeader(header, sizeof(T))) {
+                std::cerr << "Invalid binary header." << std::endl;
+                return;
+            }
+
+            std::vector<T> values;
+            T value;
+
+            for (uint64_t i = 0; i < header.count && reader.readValue(value); ++i) {
+                values.push_back(value);
+            }
+
+            for (size_t index = values.size(); index-- > 0;) {
+                push(values[index]);
+            }
+
+            reader.close();
+        }
+        else {
+            std::cerr << "Unable to open the file for binary deserialization." << std::endl;
+        }
+    }
+};
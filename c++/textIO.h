@@ -0,0 +1,154 @@
+#pragma once
+
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include <unistd.h>
+
+// Integers and floating-point values go through std::to_chars/std::from_chars,
+// which skip the locale machinery of iostreams. Character types and bool keep
+// their stream formatting, and so does every other type.
+template <typename T>
+constexpr bool hasFastTextPath = (std::is_integral_v<T> || std::is_floating_point_v<T>)
+    && !std::is_same_v<T, bool> && !std::is_same_v<T, char> && !std::is_same_v<T, signed char>
+    && !std::is_same_v<T, unsigned char> && !std::is_same_v<T, wchar_t>
+    && !std::is_same_v<T, char16_t> && !std::is_same_v<T, char32_t>;
+
+template <typename T>
+void appendText(std::string& out, const T& value) {
+    if constexpr (hasFastTextPath<T>) {
+        char buffer[64];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        out.append(buffer, result.ptr);
+    }
+    else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+        out.append(std::string_view(value));
+    }
+    else {
+        std::ostringstream oss;
+        oss << value;
+        out += oss.str();
+    }
+}
+
+template <typename T>
+bool parseText(std::string_view token, T& value) {
+    if constexpr (hasFastTextPath<T>) {
+        auto result = std::from_chars(token.data(), token.data() + token.size(), value);
+        return result.ec == std::errc() && result.ptr == token.data() + token.size();
+    }
+    else if constexpr (std::is_same_v<T, std::string>) {
+        value.assign(token);
+        return true;
+    }
+    else {
+        std::istringstream iss{ std::string(token) };
+        return static_cast<bool>(iss >> value);
+    }
+}
+
+// Splits whitespace-separated text into tokens without copying it.
+class TextReader {
+public:
+    explicit TextReader(std::string_view data) : cursor(data.data()), end(data.data() + data.size()) {}
+
+    bool nextToken(std::string_view& token) {
+        while (cursor != end && std::isspace(static_cast<unsigned char>(*cursor))) {
+            ++cursor;
+        }
+
+        if (cursor == end) {
+            return false;
+        }
+
+        const char* start = cursor;
+
+        while (cursor != end && !std::isspace(static_cast<unsigned char>(*cursor))) {
+            ++cursor;
+        }
+
+        token = std::string_view(start, cursor - start);
+        return true;
+    }
+
+    template <typename T>
+    bool read(T& value) {
+        std::string_view token;
+        return nextToken(token) && parseText(token, value);
+    }
+
+private:
+    const char* cursor;
+    const char* end;
+};
+
+// Formats into a fixed buffer and hands it to write(2) in chunks, so the whole
+// text never has to exist in memory at once.
+class TextWriter {
+public:
+    static constexpr size_t BUFFER_SIZE = 1 << 16;
+
+    explicit TextWriter(int fd) : fd(fd), written(0), failed(false) {
+        buffer.reserve(BUFFER_SIZE);
+    }
+
+    TextWriter(const TextWriter&) = delete;
+    TextWriter& operator=(const TextWriter&) = delete;
+
+    ~TextWriter() {
+        flush();
+    }
+
+    bool good() const {
+        return fd >= 0 && !failed;
+    }
+
+    uint64_t bytesWritten() const {
+        return written + buffer.size();
+    }
+
+    template <typename T>
+    void write(const T& value) {
+        appendText(buffer, value);
+
+        if (buffer.size() >= BUFFER_SIZE - 64) {
+            flush();
+        }
+    }
+
+    void flush() {
+        const char* data = buffer.data();
+        size_t size = buffer.size();
+
+        while (size > 0 && good()) {
+            ssize_t result = ::write(fd, data, size);
+
+            if (result <= 0) {
+                failed = true;
+                break;
+            }
+
+            data += result;
+            size -= result;
+            written += result;
+        }
+
+        buffer.clear();
+    }
+
+private:
+    int fd;
+    std::string buffer;
+    uint64_t written;
+    bool failed;
+};
+
+template <typename T>
+void appendText(TextWriter& writer, const T& value) {
+    writer.write(value);
+}
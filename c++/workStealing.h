@@ -0,0 +1,381 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Chase-Lev deque: the owning thread pushes and pops at the back like a stack,
+// while any other thread steals from the front. Only the last element is
+// contended, so the owner's path is a couple of plain loads and stores. The ring
+// doubles when full; replaced rings are kept until the deque is destroyed
+// because a thief may still be reading from one.
+template <typename T>
+class WorkStealingDeque {
+    static_assert(std::is_trivially_copyable_v<T>, "work-stealing deques hold trivially copyable values");
+
+public:
+    explicit WorkStealingDeque(size_t capacity = 1024) : front(0), back(0) {
+        size_t rounded = 1;
+
+        while (rounded < capacity) {
+            rounded <<= 1;
+        }
+
+        rings.push_back(std::make_unique<Ring>(rounded));
+        ring.store(rings.back().get(), std::memory_order_relaxed);
+    }
+
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+    // Owner only.
+    void pushBack(const T& value) {
+        int64_t last = back.load(std::memory_order_relaxed);
+        int64_t first = front.load(std::memory_order_acquire);
+        Ring* current = ring.load(std::memory_order_relaxed);
+
+        if (last - first >= static_cast<int64_t>(current->capacity)) {
+            current = grow(current, first, last);
+        }
+
+        current->put(last, value);
+        std::atomic_thread_fence(std::memory_order_release);
+        back.store(last + 1, std::memory_order_relaxed);
+    }
+
+    // Owner only.
+    std::optional<T> popBack() {
+        int64_t last = back.load(std::memory_order_relaxed) - 1;
+        Ring* current = ring.load(std::memory_order_relaxed);
+        back.store(last, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t first = front.load(std::memory_order_relaxed);
+
+        if (first > last) {
+            back.store(last + 1, std::memory_order_relaxed);
+            return std::nullopt;
+        }
+
+        T value = current->get(last);
+
+        if (first == last) {
+            bool won = front.compare_exchange_strong(first, first + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            back.store(last + 1, std::memory_order_relaxed);
+
+            if (!won) {
+                return std::nullopt;
+            }
+        }
+
+        return value;
+    }
+
+    // Any thread. Returns std::nullopt when the deque is empty or another thread
+    // took the front element first.
+    std::optional<T> steal() {
+        int64_t first = front.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t last = back.load(std::memory_order_acquire);
+
+        if (first >= last) {
+            return std::nullopt;
+        }
+
+        T value = ring.load(std::memory_order_acquire)->get(first);
+
+        if (!front.compare_exchange_strong(first, first + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return std::nullopt;
+        }
+
+        return value;
+    }
+
+    bool isEmpty() const {
+        return back.load(std::memory_order_relaxed) <= front.load(std::memory_order_relaxed);
+    }
+
+    size_t size() const {
+        int64_t count = back.load(std::memory_order_relaxed) - front.load(std::memory_order_relaxed);
+        return count > 0 ? static_cast<size_t>(count) : 0;
+    }
+
+private:
+    struct Ring {
+        size_t capacity;
+        std::unique_ptr<std::atomic<T>[]> items;
+
+        explicit Ring(size_t capacity) : capacity(capacity), items(new std::atomic<T>[capacity]) {}
+
+        T get(int64_t position) const {
+            return items[position & (capacity - 1)].load(std::memory_order_relaxed);
+        }
+
+        void put(int64_t position, const T& value) {
+            items[position & (capacity - 1)].store(value, std::memory_order_relaxed);
+        }
+    };
+
+    alignas(64) std::atomic<int64_t> front;
+    alignas(64) std::atomic<int64_t> back;
+    std::atomic<Ring*> ring;
+    std::vector<std::unique_ptr<Ring>> rings;
+
+    Ring* grow(Ring* current, int64_t first, int64_t last) {
+        rings.push_back(std::make_unique<Ring>(current->capacity * 2));
+        Ring* larger = rings.back().get();
+
+        for (int64_t position = first; position < last; ++position) {
+            larger->put(position, current->get(position));
+        }
+
+        ring.store(larger, std::memory_order_release);
+        return larger;
+    }
+};
+
+// Fork-join scheduler with one WorkStealingDeque per worker. Work spawned by a
+// worker goes onto its own deque and is popped newest first; idle workers steal
+// the oldest work from a randomly chosen victim. Work submitted from outside the
+// pool goes through a shared injection queue. Threads waiting on a TaskGroup run
+// pending tasks instead of blocking, so nested fork-join cannot starve the pool.
+// Tasks must not throw.
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threads = std::thread::hardware_concurrency())
+        : stopping(false), injectedCount(0), epoch(0), sleeping(0) {
+        threads = std::max<size_t>(threads, 1);
+
+        for (size_t index = 0; index < threads; ++index) {
+            deques.push_back(std::make_unique<WorkStealingDeque<Task*>>());
+        }
+
+        for (size_t index = 0; index < threads; ++index) {
+            workers.emplace_back([this, index]() { work(index); });
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping.store(true);
+        }
+
+        wake.notify_all();
+
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    static ThreadPool& shared() {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    size_t size() const {
+        return workers.size();
+    }
+
+    // A set of tasks that can be waited for together. wait() runs pending work
+    // of the pool until every task of the group has finished.
+    class TaskGroup {
+    public:
+        explicit TaskGroup(ThreadPool& pool = ThreadPool::shared()) : pool(pool), pending(0) {}
+
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup& operator=(const TaskGroup&) = delete;
+
+        ~TaskGroup() {
+            wait();
+        }
+
+        template <typename Work>
+        void run(Work&& work) {
+            pending.fetch_add(1, std::memory_order_relaxed);
+            pool.submit(new Task{std::function<void()>(std::forward<Work>(work)), this});
+        }
+
+        void wait() {
+            while (pending.load(std::memory_order_acquire) != 0) {
+                if (!pool.runPending()) {
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+    private:
+        friend class ThreadPool;
+
+        ThreadPool& pool;
+        std::atomic<size_t> pending;
+    };
+
+    // Calls body(first, last) on disjoint subranges of [begin, end) no longer
+    // than grain, and returns when all of them are done.
+    template <typename Body>
+    void parallelFor(size_t begin, size_t end, size_t grain, const Body& body) {
+        TaskGroup group(*this);
+        splitRange(group, begin, end, std::max<size_t>(grain, 1), body);
+        group.wait();
+    }
+
+private:
+    struct Task {
+        std::function<void()> work;
+        TaskGroup* group;
+    };
+
+    static constexpr int IDLE_SPINS = 64;
+
+    std::vector<std::unique_ptr<WorkStealingDeque<Task*>>> deques;
+    std::vector<std::thread> workers;
+    std::atomic<bool> stopping;
+
+    std::mutex injectedMutex;
+    std::deque<Task*> injected;
+    std::atomic<size_t> injectedCount;
+
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::atomic<uint64_t> epoch;
+    std::atomic<size_t> sleeping;
+
+    static inline thread_local ThreadPool* currentPool = nullptr;
+    static inline thread_local size_t currentIndex = 0;
+    static inline thread_local uint64_t randomState = 0;
+
+    template <typename Body>
+    void splitRange(TaskGroup& group, size_t begin, size_t end, size_t grain, const Body& body) {
+        while (end - begin > grain) {
+            size_t middle = begin + (end - begin) / 2;
+            group.run([this, &group, middle, end, grain, &body]() { splitRange(group, middle, end, grain, body); });
+            end = middle;
+        }
+
+        body(begin, end);
+    }
+
+    void submit(Task* task) {
+        if (currentPool == this) {
+            deques[currentIndex]->pushBack(task);
+        }
+        else {
+            std::lock_guard<std::mutex> lock(injectedMutex);
+            injected.push_back(task);
+            injectedCount.fetch_add(1, std::memory_order_release);
+        }
+
+        epoch.fetch_add(1, std::memory_order_seq_cst);
+
+        if (sleeping.load(std::memory_order_seq_cst) > 0) {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            wake.notify_one();
+        }
+    }
+
+    // Runs one pending task, if any can be found; used by workers and by threads
+    // waiting on a TaskGroup.
+    bool runPending() {
+        Task* task = findTask();
+
+        if (task == nullptr) {
+            return false;
+        }
+
+        task->work();
+        task->group->pending.fetch_sub(1, std::memory_order_release);
+        delete task;
+        return true;
+    }
+
+    Task* findTask() {
+        if (currentPool == this) {
+            if (std::optional<Task*> own = deques[currentIndex]->popBack()) {
+                return *own;
+            }
+        }
+
+        if (injectedCount.load(std::memory_order_acquire) > 0) {
+            std::lock_guard<std::mutex> lock(injectedMutex);
+
+            if (!injected.empty()) {
+                Task* task = injected.front();
+                injected.pop_front();
+                injectedCount.fetch_sub(1, std::memory_order_relaxed);
+                return task;
+            }
+        }
+
+        size_t count = deques.size();
+        size_t start = nextRandom() % count;
+
+        for (size_t offset = 0; offset < count; ++offset) {
+            size_t victim = (start + offset) % count;
+
+            if (currentPool == this && victim == currentIndex) {
+                continue;
+            }
+
+            if (std::optional<Task*> stolen = deques[victim]->steal()) {
+                return *stolen;
+            }
+        }
+
+        return nullptr;
+    }
+
+    static uint64_t nextRandom() {
+        if (randomState == 0) {
+            randomState = std::hash<std::thread::id>()(std::this_thread::get_id()) | 1;
+        }
+
+        randomState ^= randomState << 13;
+        randomState ^= randomState >> 7;
+        randomState ^= randomState << 17;
+        return randomState;
+    }
+
+    void work(size_t index) {
+        currentPool = this;
+        currentIndex = index;
+
+        while (true) {
+            uint64_t seen = epoch.load(std::memory_order_seq_cst);
+            bool found = false;
+
+            for (int spin = 0; spin < IDLE_SPINS && !found; ++spin) {
+                found = runPending();
+
+                if (!found) {
+                    std::this_thread::yield();
+                }
+            }
+
+            if (found) {
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(sleepMutex);
+
+            if (stopping.load()) {
+                return;
+            }
+
+            sleeping.fetch_add(1, std::memory_order_seq_cst);
+            wake.wait(lock, [this, seen]() { return stopping.load() || epoch.load(std::memory_order_seq_cst) != seen; });
+            sleeping.fetch_sub(1, std::memory_order_seq_cst);
+        }
+    }
+};
@@ -1,68 +1,166 @@
-use criterion::{criterion_group, criterion_main, Criterion};
-use serde::{Serialize, Deserialize};
+use serde::de::DeserializeOwned;
+use serde::{Deserialize, Serialize};
+use std::fmt::{Display, Write as _};
+use std::fs::File;
+use std::io::{self, BufWriter, Write};
+use std::str::FromStr;
 
-#[derive(Serialize, Deserialize, Debug)]
-struct Node<T> {
-    data: T,
-    next: Option<Box<Node<T>>>,
+/// Stack over contiguous storage: the top is the end of the vector, so push and
+/// pop never allocate once the capacity has grown to the working size.
+#[derive(Serialize, Deserialize, Debug, Clone, Default, PartialEq)]
+pub struct Stack<T> {
+    items: Vec<T>,
 }
 
-#[derive(Debug)]
-struct Stack<T> {
-    top: Option<Box<Node<T>>>,
+impl<T> Stack<T> {
+    pub fn new() -> Self {
+        Stack { items: Vec::new() }
+    }
+
+    pub fn with_capacity(capacity: usize) -> Self {
+        Stack { items: Vec::with_capacity(capacity) }
+    }
+
+    pub fn push(&mut self, value: T) {
+        self.items.push(value);
+    }
+
+    pub fn pop(&mut self) -> Option<T> {
+        self.items.pop()
+    }
+
+    pub fn peek(&self) -> Option<&T> {
+        self.items.last()
+    }
+
+    pub fn len(&self) -> usize {
+        self.items.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.items.is_empty()
+    }
+
+    pub fn clear(&mut self) {
+        self.items.clear();
+    }
+
+    /// Elements from the top down.
+    pub fn iter(&self) -> impl Iterator<Item = &T> {
+        self.items.iter().rev()
+    }
 }
 
-impl<T: std::fmt::Display + std::str::FromStr + Serialize + Deserialize> Stack<T> {
+impl<T: Display> Stack<T> {
+    /// Elements from the top down, each followed by a space, as the C++ Stack
+    /// writes them.
+    pub fn serialize_text(&self) -> String {
+        let mut text = String::with_capacity(self.items.len() * 4);
 
-    fn bench_push(c: &mut Criterion) {
-        let mut my_stack = Stack::new();
+        for item in self.iter() {
+            let _ = write!(text, "{} ", item);
+        }
 
-        c.bench_function("push", |b| b.iter(|| my_stack.push(42)));
+        text
     }
+}
 
-    fn bench_serialize_text(c: &mut Criterion) {
-        let mut my_stack = Stack::new();
-        my_stack.push(1);
-        my_stack.push(2);
-        my_stack.push(3);
+impl<T: FromStr> Stack<T> {
+    /// Parses whitespace-separated elements, top first, straight from slices of
+    /// data and places them above the existing elements. Tokens that do not
+    /// parse are skipped.
+    pub fn deserialize_text(&mut self, data: &str) {
+        let first = self.items.len();
+
+        for token in data.split_ascii_whitespace() {
+            if let Ok(value) = token.parse() {
+                self.items.push(value);
+            }
+        }
 
-        c.bench_function("serialize_text", |b| b.iter(|| my_stack.serialize_text()));
+        self.items[first..].reverse();
     }
+}
 
-    fn bench_deserialize_text(c: &mut Criterion) {
-        let mut my_stack = Stack::new();
-        let text_data = "3 2 1";
+impl<T: Serialize> Stack<T> {
+    /// Writes the whole stack with bincode: the element count followed by the
+    /// elements from the bottom up.
+    pub fn serialize_binary(&self, filename: &str) -> io::Result<()> {
+        let mut writer = BufWriter::new(File::create(filename)?);
+        bincode::serialize_into(&mut writer, &self.items).map_err(into_io)?;
+        writer.flush()
+    }
+}
 
-        c.bench_function("deserialize_text", |b| b.iter(|| my_stack.deserialize_text(text_data)));
+impl<T: DeserializeOwned> Stack<T> {
+    /// Reads a file written by serialize_binary in one read and places its
+    /// elements above the existing ones.
+    pub fn deserialize_binary(&mut self, filename: &str) -> io::Result<()> {
+        let bytes = std::fs::read(filename)?;
+        let loaded: Vec<T> = bincode::deserialize(&bytes).map_err(into_io)?;
+
+        if self.items.is_empty() {
+            self.items = loaded;
+        } else {
+            self.items.extend(loaded);
+        }
+
+        Ok(())
     }
+}
+
+fn into_io(error: bincode::Error) -> io::Error {
+    io::Error::new(io::ErrorKind::InvalidData, error)
+}
 
-    fn bench_serialize_binary(c: &mut Criterion) {
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn push_pop() {
         let mut my_stack = Stack::new();
         my_stack.push(1);
         my_stack.push(2);
-        my_stack.push(3);
 
-        c.bench_function("serialize_binary", |b| b.iter(|| my_stack.serialize_binary("binary_data.bin")));
+        assert_eq!(my_stack.peek(), Some(&2));
+        assert_eq!(my_stack.pop(), Some(2));
+        assert_eq!(my_stack.pop(), Some(1));
+        assert_eq!(my_stack.pop(), None);
+        assert!(my_stack.is_empty());
     }
 
-    fn bench_deserialize_binary(c: &mut Criterion) {
+    #[test]
+    fn text_round_trip() {
         let mut my_stack = Stack::new();
         my_stack.push(1);
         my_stack.push(2);
         my_stack.push(3);
-        my_stack.serialize_binary("binary_data.bin");
 
-        c.bench_function("deserialize_binary", |b| b.iter(|| my_stack.deserialize_binary("binary_data.bin")));
+        assert_eq!(my_stack.serialize_text(), "3 2 1 ");
+
+        let mut new_stack = Stack::new();
+        new_stack.push(0);
+        new_stack.deserialize_text("3 2 x 1");
+
+        assert_eq!(new_stack.iter().copied().collect::<Vec<i32>>(), vec![3, 2, 1, 0]);
     }
-}
 
-criterion_group!(
-    benches,
-    Stack::<i32>::bench_push,
-    Stack::<i32>::bench_serialize_text,
-    Stack::<i32>::bench_deserialize_text,
-    Stack::<i32>::bench_serialize_binary,
-    Stack::<i32>::bench_deserialize_binary,
-);
+    #[test]
+    fn binary_round_trip() {
+        let mut my_stack = Stack::new();
 
-criterion_main!(benches);
+        for i in 0..1000 {
+            my_stack.push(i);
+        }
+
+        my_stack.serialize_binary("test_stack.bin").unwrap();
+
+        let mut new_stack = Stack::new();
+        new_stack.deserialize_binary("test_stack.bin").unwrap();
+        std::fs::remove_file("test_stack.bin").unwrap();
+
+        assert_eq!(new_stack, my_stack);
+        assert!(Stack::<i32>::new().deserialize_binary("missing.bin").is_err());
+    }
+}
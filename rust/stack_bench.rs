@@ -0,0 +1,100 @@
+use criterion::{black_box, criterion_group, criterion_main, BenchmarkId, Criterion, Throughput};
+use stack::Stack;
+
+// The same workloads and sizes as the BM_Cross benchmarks in
+// c++/bench/stackBench.cpp; c++/bench/compareStack.py puts the results side by side.
+const SIZES: [usize; 3] = [1 << 10, 1 << 16, 1 << 20];
+
+fn filled(size: usize) -> Stack<i32> {
+    let mut my_stack = Stack::new();
+
+    for i in 0..size {
+        my_stack.push(i as i32);
+    }
+
+    my_stack
+}
+
+fn bench_push(c: &mut Criterion) {
+    let mut group = c.benchmark_group("push");
+
+    for size in SIZES {
+        group.throughput(Throughput::Elements(size as u64));
+        group.bench_function(BenchmarkId::from_parameter(size), |b| b.iter(|| filled(black_box(size))));
+    }
+
+    group.finish();
+}
+
+fn bench_serialize_text(c: &mut Criterion) {
+    let mut group = c.benchmark_group("serialize_text");
+
+    for size in SIZES {
+        let my_stack = filled(size);
+        group.throughput(Throughput::Elements(size as u64));
+        group.bench_function(BenchmarkId::from_parameter(size), |b| b.iter(|| my_stack.serialize_text()));
+    }
+
+    group.finish();
+}
+
+fn bench_deserialize_text(c: &mut Criterion) {
+    let mut group = c.benchmark_group("deserialize_text");
+
+    for size in SIZES {
+        let text_data = filled(size).serialize_text();
+        group.throughput(Throughput::Elements(size as u64));
+        group.bench_function(BenchmarkId::from_parameter(size), |b| {
+            b.iter(|| {
+                let mut my_stack = Stack::<i32>::new();
+                my_stack.deserialize_text(&text_data);
+                my_stack
+            })
+        });
+    }
+
+    group.finish();
+}
+
+fn bench_serialize_binary(c: &mut Criterion) {
+    let mut group = c.benchmark_group("serialize_binary");
+
+    for size in SIZES {
+        let my_stack = filled(size);
+        group.throughput(Throughput::Elements(size as u64));
+        group.bench_function(BenchmarkId::from_parameter(size), |b| {
+            b.iter(|| my_stack.serialize_binary("binary_data.bin").unwrap())
+        });
+    }
+
+    group.finish();
+}
+
+fn bench_deserialize_binary(c: &mut Criterion) {
+    let mut group = c.benchmark_group("deserialize_binary");
+
+    for size in SIZES {
+        filled(size).serialize_binary("binary_data.bin").unwrap();
+        group.throughput(Throughput::Elements(size as u64));
+        group.bench_function(BenchmarkId::from_parameter(size), |b| {
+            b.iter(|| {
+                let mut my_stack = Stack::<i32>::new();
+                my_stack.deserialize_binary("binary_data.bin").unwrap();
+                my_stack
+            })
+        });
+    }
+
+    group.finish();
+}
+
+criterion_group!(
+    benches,
+    bench_push,
+    bench_serialize_text,
+    bench_deserialize_text,
+    bench_serialize_binary,
+    bench_deserialize_binary,
+);
+
+criterion_main!(benches);